@@ -0,0 +1,40 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <string>
+
+// 每次请求都新建并丢弃一个临时列表，比较不同内存资源的开销
+struct Record {
+    long id;
+    double values[6];
+};
+
+template<typename F>
+void run(const char *name, int n, F setup) {
+    bench::report(name, bench::time_ns([&] {
+        setup([&] {
+            crz::plist l;
+            l.reserve(n);
+            for (int i = 0; i < n; ++i)
+                l.push_back(Record{i, {double(i)}});
+            crz::plist copy = l;
+            bench::keep(copy);
+        });
+    }) / n);
+}
+
+int main() {
+    const int n = 1 << 12;
+    run("default new/delete (per element)", n, [](std::function<void()> f) {
+        f();
+    });
+    run("arena_resource (per element)", n, [](std::function<void()> f) {
+        crz::arena_resource arena(1 << 16);
+        crz::resource_scope scope(&arena);
+        f();
+    });
+    crz::pool_resource pool;
+    run("pool_resource (per element)", n, [&](std::function<void()> f) {
+        crz::resource_scope scope(&pool);
+        f();
+    });
+}
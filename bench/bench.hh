@@ -0,0 +1,39 @@
+#ifndef __CRZ_BENCH_HH__
+#define __CRZ_BENCH_HH__
+
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+
+namespace bench {
+
+// 防止编译器把被测的计算优化掉
+template<typename T>
+inline void keep(const T &t) {
+    asm volatile("" : : "g"(&t) : "memory");
+}
+
+// 重复运行f直到总耗时超过阈值，返回每次运行的平均耗时（纳秒）
+template<typename F>
+double time_ns(F f, double min_ns = 2e8) {
+    using clock = std::chrono::steady_clock;
+    std::size_t iters = 1;
+    for (;;) {
+        auto begin = clock::now();
+        for (std::size_t i = 0; i < iters; ++i)
+            f();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+        if (ns >= min_ns)
+            return ns / iters;
+        iters *= 2;
+    }
+}
+
+// 输出一行结果：名称、每次操作的耗时
+inline void report(const char *name, double ns_per_op) {
+    std::printf("%-40s %12.2f ns/op\n", name, ns_per_op);
+}
+
+}
+
+#endif //__CRZ_BENCH_HH__
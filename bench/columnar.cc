@@ -0,0 +1,29 @@
+#include "bench.hh"
+#include "plist.hh"
+#include "plist_of.hh"
+
+// 归约操作：plist上逐个转换元素与按列存储的plist_of的比较
+int main() {
+    const int n = 1 << 18;
+    crz::plist l;
+    crz::plist_of<double> col;
+    for (int i = 0; i < n; ++i) {
+        l.push_back(i * 0.5);
+        col.append(i * 0.5);
+    }
+    bench::report("plist sum (per element)", bench::time_ns([&] {
+        double s = 0;
+        for (const auto &x: l)
+            s += x.cast<double>();
+        bench::keep(s);
+    }) / n);
+    bench::report("plist_of<double> sum (per element)", bench::time_ns([&] {
+        bench::keep(col.sum());
+    }) / n);
+    bench::report("plist max (per element)", bench::time_ns([&] {
+        bench::keep(*std::max_element(l.begin(), l.end()));
+    }) / n);
+    bench::report("plist_of<double> max (per element)", bench::time_ns([&] {
+        bench::keep(col.max());
+    }) / n);
+}
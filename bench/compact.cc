@@ -0,0 +1,35 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <cstdlib>
+
+// 按随机的键排序之后，顺序遍历堆上的对象：整理前按随机的顺序访问内存，整理后顺序访问
+struct Record {
+    long id;
+    double values[6];
+};
+
+double scan(const crz::plist &l) {
+    double sum = 0;
+    for (const auto &x: l)
+        sum += x.cast<const Record &>().values[0];
+    return sum;
+}
+
+int main() {
+    const int n = 1 << 18;
+    std::srand(233);
+    crz::plist l;
+    for (int i = 0; i < n; ++i)
+        l.append(Record{std::rand(), {double(i)}});
+    l.sort(false, [](const Record &r) { return r.id; });
+
+    bench::report("scan after sort (per element)", bench::time_ns([&] {
+        bench::keep(scan(l));
+    }) / n);
+    bench::report("compact (per element)", bench::time_ns([&] {
+        l.compact();
+    }) / n);
+    bench::report("scan after compact (per element)", bench::time_ns([&] {
+        bench::keep(scan(l));
+    }) / n);
+}
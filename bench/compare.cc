@@ -0,0 +1,90 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// pcell比较运算的开销：同类型比较、不同类型的==，以及对整个列表排序时的比较开销
+int main() {
+    const int n = 1 << 16;
+    std::srand(233);
+    crz::plist ints, strs;
+    for (int i = 0; i < n; ++i) {
+        ints.push_back(std::rand());
+        strs.push_back(std::to_string(std::rand()));
+    }
+    crz::pcell i1 = 1, i2 = 2, d = 1.0;
+
+    bench::report("pcell int < int", bench::time_ns([&] {
+        bench::keep(i1 < i2);
+    }));
+    bench::report("pcell int == int", bench::time_ns([&] {
+        bench::keep(i1 == i2);
+    }));
+    bench::report("pcell int == double", bench::time_ns([&] {
+        bench::keep(i1 == d);
+    }));
+    bench::report("pcell isa<int>", bench::time_ns([&] {
+        bench::keep(i1.isa<int>());
+    }));
+    bench::report("pcell cast<int>", bench::time_ns([&] {
+        bench::keep(i1.cast<int>());
+    }));
+    // 探测类型：异常作为控制流、先isa再cast、try_cast
+    bench::report("pcell probe by catching bad_pcell_cast", bench::time_ns([&] {
+        int r = 0;
+        try {
+            r = d.cast<int>();
+        } catch (crz::bad_pcell_cast &) {
+            r = -1;
+        }
+        bench::keep(r);
+    }, 2e7));
+    bench::report("pcell probe by isa<int> + cast<int>", bench::time_ns([&] {
+        bench::keep(d.isa<int>() ? d.cast<int>() : -1);
+    }));
+    bench::report("pcell probe by try_cast<int>", bench::time_ns([&] {
+        auto p = d.try_cast<int>();
+        bench::keep(p ? *p : -1);
+    }));
+    bench::report("pcell int < double by catching", bench::time_ns([&] {
+        bool r = false;
+        try {
+            r = i1 < d;
+        } catch (crz::bad_comparison &) {
+        }
+        bench::keep(r);
+    }, 2e7));
+    bench::report("pcell int compare double", bench::time_ns([&] {
+        bench::keep(i1.compare(d));
+    }));
+
+    // 对每个元素做一次比较，换算成每次比较的耗时
+    bench::report("plist scan of int < (per element)", bench::time_ns([&] {
+        int cnt = 0;
+        for (int i = 1; i < n; ++i)
+            cnt += ints[i - 1] < ints[i];
+        bench::keep(cnt);
+    }) / n);
+    bench::report("plist scan of string < (per element)", bench::time_ns([&] {
+        int cnt = 0;
+        for (int i = 1; i < n; ++i)
+            cnt += strs[i - 1] < strs[i];
+        bench::keep(cnt);
+    }) / n);
+    // 排序时每个元素的耗时
+    bench::report("sort pcell ints (per element)", bench::time_ns([&] {
+        std::vector<crz::pcell> v(ints.begin(), ints.end());
+        std::sort(v.begin(), v.end());
+        bench::keep(v);
+    }) / n);
+    // 混合类型的列表只能用全序排序
+    crz::plist mixed;
+    for (int i = 0; i < n; ++i)
+        i % 2 ? mixed.push_back(ints[i]) : mixed.push_back(strs[i]);
+    bench::report("total_order sort mixed (per element)", bench::time_ns([&] {
+        crz::plist v = mixed;
+        v.sort(crz::total_order);
+        bench::keep(v);
+    }) / n);
+}
@@ -0,0 +1,45 @@
+#include "bench.hh"
+#include "plist.hh"
+#include "concurrent_plist.hh"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 多个线程同时追加元素：全局互斥锁保护的plist与concurrent_plist的吞吐量随线程数的变化
+template<typename F>
+void run_threads(int threads, F f) {
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; ++t)
+        ts.emplace_back(f);
+    for (auto &t: ts)
+        t.join();
+}
+
+int main() {
+    const int n = 1 << 18;
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        int per = n / threads;
+        std::string name = "mutex + plist, " + std::to_string(threads) + " threads (per append)";
+        bench::report(name.c_str(), bench::time_ns([&] {
+            crz::plist l;
+            std::mutex m;
+            run_threads(threads, [&] {
+                for (int i = 0; i < per; ++i) {
+                    std::lock_guard<std::mutex> lock(m);
+                    l.append(i);
+                }
+            });
+            bench::keep(l);
+        }) / n);
+        name = "concurrent_plist, " + std::to_string(threads) + " threads (per append)";
+        bench::report(name.c_str(), bench::time_ns([&] {
+            crz::concurrent_plist l;
+            run_threads(threads, [&] {
+                for (int i = 0; i < per; ++i)
+                    l.append(i);
+            });
+            bench::keep(l);
+        }) / n);
+    }
+}
@@ -0,0 +1,32 @@
+#include "bench.hh"
+#include "plist.hh"
+
+// 按值传递嵌套的列表：plist每次深拷贝整棵树，cow_plist只增加引用计数
+template<typename L>
+size_t pass(L l, int depth) {
+    return depth == 0 ? l.size() : pass(l, depth - 1);
+}
+
+int main() {
+    const int n = 1 << 10, layers = 16;
+    crz::plist pl;
+    crz::cow_plist cl;
+    for (int i = 0; i < n; ++i) {
+        crz::plist row;
+        for (int j = 0; j < 16; ++j)
+            row.push_back(std::to_string(i * j));
+        pl.push_back(row);
+        cl.append(crz::cow_plist(row));
+    }
+    bench::report("plist pass by value (per layer)", bench::time_ns([&] {
+        bench::keep(pass(pl, layers));
+    }) / layers);
+    bench::report("cow_plist pass by value (per layer)", bench::time_ns([&] {
+        bench::keep(pass(cl, layers));
+    }) / layers);
+    bench::report("cow_plist copy + first write", bench::time_ns([&] {
+        crz::cow_plist c = cl;
+        c[0] = 1;
+        bench::keep(c);
+    }));
+}
@@ -0,0 +1,63 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <string>
+
+// 向列表中添加字符串和较大的用户类型：先构造临时pcell再拷贝、移动临时pcell、原位构造
+struct Record {
+    long id;
+    double values[6];
+    Record(long id, double v) : id(id), values{v} {}
+};
+
+int main() {
+    const int n = 1 << 12;
+    const std::string text(40, 'x'); // 超过短字符串优化的长度，拷贝需要分配内存
+
+    bench::report("append string, copy temporary pcell", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            crz::pcell tmp = std::string(text);
+            l.append(static_cast<const crz::pcell &>(tmp));
+        }
+        bench::keep(l);
+    }) / n);
+    bench::report("append string, move rvalue", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i)
+            l.append(std::string(text));
+        bench::keep(l);
+    }) / n);
+    bench::report("emplace_back<std::string>", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i)
+            l.emplace_back<std::string>(text);
+        bench::keep(l);
+    }) / n);
+
+    bench::report("append Record, copy temporary pcell", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            crz::pcell tmp = Record(i, 0.5);
+            l.append(static_cast<const crz::pcell &>(tmp));
+        }
+        bench::keep(l);
+    }) / n);
+    bench::report("append Record, move rvalue", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i)
+            l.append(Record(i, 0.5));
+        bench::keep(l);
+    }) / n);
+    bench::report("emplace_back<Record>", bench::time_ns([&] {
+        crz::plist l;
+        l.reserve(n);
+        for (int i = 0; i < n; ++i)
+            l.emplace_back<Record>(i, 0.5);
+        bench::keep(l);
+    }) / n);
+}
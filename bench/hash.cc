@@ -0,0 +1,39 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <cstdlib>
+#include <string>
+
+// 成员判断：逐个调用index的线性查找与基于哈希的intersect、哈希索引的比较
+int main() {
+    const int n = 1 << 12;
+    std::srand(233);
+    crz::plist a, b;
+    for (int i = 0; i < n; ++i) {
+        a.push_back(std::to_string(std::rand() % (2 * n)));
+        b.push_back(std::to_string(std::rand() % (2 * n)));
+    }
+    bench::report("intersect by index scan (per element)", bench::time_ns([&] {
+        crz::plist res;
+        for (const auto &x: a) {
+            if (b.index(x) != -1 && res.index(x) == -1)
+                res.push_back(x);
+        }
+        bench::keep(res);
+    }) / n);
+    bench::report("intersect by hash (per element)", bench::time_ns([&] {
+        bench::keep(a.intersect(b));
+    }) / n);
+    auto idx = b.hash_index();
+    bench::report("plist index (per lookup)", bench::time_ns([&] {
+        int s = 0;
+        for (const auto &x: a)
+            s += b.index(x);
+        bench::keep(s);
+    }) / n);
+    bench::report("plist_index index (per lookup)", bench::time_ns([&] {
+        int s = 0;
+        for (const auto &x: a)
+            s += idx.index(x);
+        bench::keep(s);
+    }) / n);
+}
@@ -0,0 +1,45 @@
+#include "bench.hh"
+#include "plist.hh"
+#include "plist_io.hh"
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// 列表的导出和导入：文本输出、二进制的dump/load，以及映射加载后随机访问少量元素
+int main() {
+    const int n = 1 << 18;
+    crz::plist l;
+    for (int i = 0; i < n; ++i) {
+        if (i % 2)
+            l.push_back(i * 0.5);
+        else
+            l.push_back(std::to_string(i));
+    }
+    bench::report("text output (per element)", bench::time_ns([&] {
+        std::ostringstream os;
+        os << l;
+        bench::keep(os);
+    }) / n);
+    bench::report("binary dump (per element)", bench::time_ns([&] {
+        std::ostringstream os;
+        crz::dump(l, os);
+        bench::keep(os);
+    }) / n);
+    std::stringstream ss;
+    crz::dump(l, ss);
+    std::string data = ss.str();
+    bench::report("binary load (per element)", bench::time_ns([&] {
+        std::istringstream is(data);
+        bench::keep(crz::load(is));
+    }) / n);
+    const char *path = "bench_io.bin";
+    crz::dump(l, path);
+    bench::report("mapped_plist open + 1000 get", bench::time_ns([&] {
+        crz::mapped_plist ml(path);
+        double s = 0;
+        for (int i = 1; i < 2000; i += 2)
+            s += ml.get<double>(i * 97 % n | 1);
+        bench::keep(s);
+    }));
+    std::remove(path);
+}
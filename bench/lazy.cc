@@ -0,0 +1,28 @@
+#include "bench.hh"
+#include "plist.hh"
+
+// filter + map + map：逐级生成中间列表与惰性操作链的比较
+int main() {
+    const int n = 1 << 18;
+    crz::plist l;
+    for (int i = 0; i < n; ++i)
+        l.push_back(i);
+    bench::report("eager filter.map.map (per element)", bench::time_ns([&] {
+        bench::keep(l.filter([](int x) { return x % 2 == 0; })
+                     .map([](int x) { return x * 3; })
+                     .map([](int x) { return x + 1.5; }));
+    }) / n);
+    bench::report("lazy filter.map.map.collect (per element)", bench::time_ns([&] {
+        bench::keep(l.lazy()
+                     .filter([](int x) { return x % 2 == 0; })
+                     .map([](int x) { return x * 3; })
+                     .map([](int x) { return x + 1.5; })
+                     .collect());
+    }) / n);
+    bench::report("lazy filter.map.reduce (per element)", bench::time_ns([&] {
+        bench::keep(l.lazy()
+                     .filter([](int x) { return x % 2 == 0; })
+                     .map([](int x) { return x * 3; })
+                     .reduce(0.0, [](double acc, int x) { return acc + x; }));
+    }) / n);
+}
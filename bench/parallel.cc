@@ -0,0 +1,28 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <cstdlib>
+#include <string>
+
+// 并行的map、filter、sort在不同线程数下的耗时
+int main() {
+    const int n = 1 << 20;
+    std::srand(233);
+    crz::plist l;
+    for (int i = 0; i < n; ++i)
+        l.push_back(std::rand() / 7.0);
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+        crz::par pol(threads);
+        std::string suffix = " (" + std::to_string(threads) + " threads, per element)";
+        bench::report(("map" + suffix).c_str(), bench::time_ns([&] {
+            bench::keep(l.map(pol, [](double x) { return x * 2; }));
+        }) / n);
+        bench::report(("filter" + suffix).c_str(), bench::time_ns([&] {
+            bench::keep(l.filter(pol, [](double x) { return x < 1e8; }));
+        }) / n);
+        bench::report(("sort" + suffix).c_str(), bench::time_ns([&] {
+            auto c = l;
+            c.sort(pol);
+            bench::keep(c);
+        }) / n);
+    }
+}
@@ -0,0 +1,40 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <sstream>
+#include <string>
+#include <cstdio>
+
+// 列表输出：逐个元素经过std::ostream、经过pbuffer的<<、转换为字符串，以及直接写入文件
+int main() {
+    const int n = 1 << 16;
+    crz::plist l;
+    for (int i = 0; i < n; ++i) {
+        if (i % 2)
+            l.push_back(i * 0.5);
+        else
+            l.push_back(i);
+    }
+    bench::report("ostream per element (per element)", bench::time_ns([&] {
+        std::ostringstream os;
+        os << '[';
+        for (const auto &x: l)
+            os << x << ", ";
+        os << ']';
+        bench::keep(os);
+    }) / n);
+    bench::report("plist << (per element)", bench::time_ns([&] {
+        std::ostringstream os;
+        os << l;
+        bench::keep(os);
+    }) / n);
+    bench::report("std::string(plist) (per element)", bench::time_ns([&] {
+        bench::keep(std::string(l));
+    }) / n);
+    std::FILE *file = std::fopen("/dev/null", "w");
+    crz::pbuffer out(file);
+    bench::report("write_to FILE (per element)", bench::time_ns([&] {
+        l.write_to(out);
+    }) / n);
+    out.flush();
+    std::fclose(file);
+}
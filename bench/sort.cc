@@ -0,0 +1,80 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 对同类型元素的列表排序，并与直接对std::vector排序比较
+int main() {
+    const int n = 1 << 16;
+    std::srand(233);
+    std::vector<double> dv;
+    std::vector<std::string> sv;
+    crz::plist dl, sl;
+    for (int i = 0; i < n; ++i) {
+        dv.push_back(std::rand() / 3.0);
+        sv.push_back(std::to_string(std::rand()));
+        dl.push_back(dv.back());
+        sl.push_back(sv.back());
+    }
+
+    bench::report("std::vector<double> sort (per element)", bench::time_ns([&] {
+        auto v = dv;
+        std::sort(v.begin(), v.end());
+        bench::keep(v);
+    }) / n);
+    bench::report("plist of double sort (per element)", bench::time_ns([&] {
+        auto l = dl;
+        l.sort();
+        bench::keep(l);
+    }) / n);
+    bench::report("plist of double reverse sort (per element)", bench::time_ns([&] {
+        auto l = dl;
+        l.sort(true);
+        bench::keep(l);
+    }) / n);
+    bench::report("std::vector<string> sort (per element)", bench::time_ns([&] {
+        auto v = sv;
+        std::sort(v.begin(), v.end());
+        bench::keep(v);
+    }) / n);
+    bench::report("plist of string sort (per element)", bench::time_ns([&] {
+        auto l = sl;
+        l.sort();
+        bench::keep(l);
+    }) / n);
+    // key需要解析字符串，开销远大于一次比较
+    bench::report("plist of string sort with key (per element)", bench::time_ns([&] {
+        auto l = sl;
+        l.sort(false, [](const std::string &s) { return std::stod(s); });
+        bench::keep(l);
+    }) / n);
+    // 大量重复元素的逆序排序：double走快速路径，std::pair走通用路径
+    crz::plist ddup, pdup;
+    for (int i = 0; i < n; ++i) {
+        ddup.push_back(static_cast<double>(std::rand() % 16));
+        pdup.push_back(std::make_pair(std::rand() % 4, std::rand() % 4));
+    }
+    bench::report("dup-heavy double reverse sort (per element)", bench::time_ns([&] {
+        auto l = ddup;
+        l.sort(true);
+        bench::keep(l);
+    }) / n);
+    bench::report("dup-heavy pair sort (per element)", bench::time_ns([&] {
+        auto l = pdup;
+        l.sort();
+        bench::keep(l);
+    }) / n);
+    bench::report("dup-heavy pair reverse sort (per element)", bench::time_ns([&] {
+        auto l = pdup;
+        l.sort(true);
+        bench::keep(l);
+    }) / n);
+    bench::report("plist of double count (per element)", bench::time_ns([&] {
+        bench::keep(dl.count(dv[n / 2]));
+    }) / n);
+    bench::report("plist of string index (per element)", bench::time_ns([&] {
+        bench::keep(sl.index(std::string("not there")));
+    }) / n);
+}
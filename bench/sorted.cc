@@ -0,0 +1,52 @@
+#include "bench.hh"
+#include "plist.hh"
+#include "sorted_plist.hh"
+#include <cstdlib>
+
+// 保持列表有序：每批追加后对整个列表重新排序，和sorted_plist先排序新元素再线性合并的对比，
+// 以及有序列表上的二分查找和线性查找的对比
+int main() {
+    const int n = 1 << 16;
+    std::srand(233);
+    crz::plist base;
+    for (int i = 0; i < n; ++i)
+        base.push_back(std::rand());
+    const crz::sorted_plist sorted(base);
+
+    const int batches[] = {16, 256, 4096};
+    for (int k: batches) {
+        crz::plist batch;
+        for (int i = 0; i < k; ++i)
+            batch.push_back(std::rand());
+        std::string name = " (batch of " + std::to_string(k) + " into " + std::to_string(n) + ")";
+        // 拷贝的开销两者相同，一并计入
+        bench::report(("append + plist::sort" + name).c_str(), bench::time_ns([&] {
+            crz::plist l = sorted.items();
+            l.extend(batch);
+            l.sort();
+            bench::keep(l);
+        }));
+        bench::report(("sorted_plist::insert_many" + name).c_str(), bench::time_ns([&] {
+            crz::sorted_plist l = sorted;
+            l.insert_many(batch);
+            bench::keep(l);
+        }));
+    }
+
+    const crz::pcell probe = sorted[n / 3], absent = -1;
+    bench::report("plist::index (linear)", bench::time_ns([&] {
+        bench::keep(sorted.items().index(probe));
+    }));
+    bench::report("sorted_plist::index (bisect)", bench::time_ns([&] {
+        bench::keep(sorted.index(probe));
+    }));
+    bench::report("sorted_plist::contains absent", bench::time_ns([&] {
+        bench::keep(sorted.contains(absent));
+    }));
+    bench::report("sorted_plist::insort (per element)", bench::time_ns([&] {
+        crz::sorted_plist l;
+        for (int i = 0; i < 1024; ++i)
+            l.insort(base[i]);
+        bench::keep(l);
+    }) / 1024);
+}
@@ -0,0 +1,231 @@
+#include "bench.hh"
+#include "plist.hh"
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// plist常用操作的综合测试：每个操作分别在元素类型相同（int）和混合类型（int、double、std::string）的列表上，
+// 以几种不同的长度运行，输出每次操作的耗时、内存分配次数和分配的字节数。
+// 用法：bench/suite [输出的csv文件] [作为对照的csv文件]。给出对照文件时额外输出相对于对照的加速比
+
+// 替换全局的operator new，统计内存分配。不内联，避免编译器把内联后的new和free误报为不匹配
+namespace {
+size_t alloc_count = 0, alloc_bytes = 0;
+}
+
+__attribute__((noinline)) void *operator new(size_t n) {
+    ++alloc_count, alloc_bytes += n;
+    if (void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const double min_ns = 5e7;          // 每项测试至少运行的时间
+const size_t max_batch_cells = 1 << 20; // 每轮预先准备的输入中元素的总数上限
+
+struct result {
+    double ns, allocs, bytes;
+};
+
+// 每轮先准备好若干份输入（不计时），再依次对它们执行op，直到总耗时超过min_ns。
+// 内存分配只统计op中发生的部分
+template<typename S, typename F>
+result measure(size_t cells, S setup, F op) {
+    using clock = std::chrono::steady_clock;
+    const size_t cap = std::max<size_t>(1, max_batch_cells / std::max<size_t>(cells, 1));
+    size_t batch = 1, runs = 0, allocs = 0, bytes = 0;
+    double total = 0;
+    while (total < min_ns) {
+        std::vector<decltype(setup())> inputs;
+        inputs.reserve(batch);
+        for (size_t i = 0; i < batch; ++i)
+            inputs.push_back(setup());
+        size_t a0 = alloc_count, b0 = alloc_bytes;
+        auto begin = clock::now();
+        for (auto &in: inputs)
+            op(in);
+        total += std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+        allocs += alloc_count - a0, bytes += alloc_bytes - b0;
+        runs += batch;
+        batch = std::min(2 * batch, cap);
+    }
+    return {total / runs, double(allocs) / runs, double(bytes) / runs};
+}
+// 不修改输入的操作，不需要每次准备新的输入，直接重复运行
+template<typename F>
+result measure(F op) {
+    size_t a0 = alloc_count, b0 = alloc_bytes, runs = 0;
+    double ns = bench::time_ns([&] { op(), ++runs; }, min_ns);
+    return {ns, double(alloc_count - a0) / runs, double(alloc_bytes - b0) / runs};
+}
+
+// 第i个元素：元素类型相同时为int，混合类型时依次为int、double、std::string
+crz::pcell make(bool mixed, int i) {
+    if (!mixed || i % 3 == 0)
+        return (i * 7919) % 10007;
+    if (i % 3 == 1)
+        return i * 0.5;
+    return std::to_string(i);
+}
+crz::plist make_list(bool mixed, int n) {
+    crz::plist l;
+    l.reserve(n);
+    for (int i = 0; i < n; ++i)
+        l.push_back(make(mixed, i));
+    return l;
+}
+
+struct row {
+    std::string workload, kind;
+    int size;
+    result r;
+};
+
+std::vector<row> rows;
+
+void add(const char *workload, bool mixed, int n, result r) {
+    rows.push_back({workload, mixed ? "mixed" : "int", n, r});
+    std::string name = std::string(workload) + (mixed ? " [mixed " : " [int ") + std::to_string(n) + "]";
+    std::printf("%-40s %14.1f ns/op %10.1f allocs/op %12.0f bytes/op\n", name.c_str(), r.ns, r.allocs, r.bytes);
+}
+
+void run(bool mixed, int n) {
+    const crz::plist src = make_list(mixed, n);
+    std::vector<crz::pcell> cells(src.begin(), src.end());
+    const crz::pcell probe = make(mixed, n / 2), absent = std::string("absent");
+
+    add("construct from iterators", mixed, n, measure([&] {
+        crz::plist l(cells.begin(), cells.end());
+        bench::keep(l);
+    }));
+    add("append", mixed, n, measure([&] {
+        crz::plist l;
+        for (int i = 0; i < n; ++i)
+            l.append(cells[i]);
+        bench::keep(l);
+    }));
+    add("negative indexing (n accesses)", mixed, n, measure([&] {
+        const crz::pcell *last = nullptr;
+        for (int i = 1; i <= n; ++i)
+            last = &src[-i];
+        bench::keep(last);
+    }));
+    add("slice view [1:-1:2]", mixed, n, measure([&] {
+        bench::keep(src[{1, -1, 2}]);
+    }));
+    add("slice copy [1:-1:2]", mixed, n, measure([&] {
+        crz::plist l = src[{1, -1, 2}];
+        bench::keep(l);
+    }));
+    add("concatenate a + b", mixed, n, measure([&] {
+        crz::plist l = src + src;
+        bench::keep(l);
+    }));
+    add("repeat a * 3", mixed, n, measure([&] {
+        crz::plist l = src * 3;
+        bench::keep(l);
+    }));
+    if (!mixed) {
+        add("sort", mixed, n, measure(n, [&] { return src; }, [](crz::plist &l) {
+            l.sort();
+        }));
+        add("sort with key", mixed, n, measure(n, [&] { return src; }, [](crz::plist &l) {
+            l.sort(false, [](int x) { return x % 100; });
+        }));
+        add("map", mixed, n, measure([&] {
+            bench::keep(const_cast<crz::plist &>(src).map([](int x) { return x * 2; }));
+        }));
+        add("filter", mixed, n, measure([&] {
+            bench::keep(const_cast<crz::plist &>(src).filter([](int x) { return x % 2 == 0; }));
+        }));
+    } else {
+        // 混合类型的列表不能直接比较，按类型名排序
+        add("sort with key", mixed, n, measure(n, [&] { return src; }, [](crz::plist &l) {
+            l.sort(false, [](const crz::pcell &c) { return std::string(c.type().name()); });
+        }));
+        add("map", mixed, n, measure([&] {
+            bench::keep(const_cast<crz::plist &>(src).map([](const crz::pcell &c) { return c.isa<int>(); }));
+        }));
+        add("filter", mixed, n, measure([&] {
+            bench::keep(const_cast<crz::plist &>(src).filter([](const crz::pcell &c) { return c.isa<int>(); }));
+        }));
+    }
+    add("count", mixed, n, measure([&] {
+        bench::keep(src.count(probe));
+    }));
+    add("index (absent)", mixed, n, measure([&] {
+        bench::keep(src.index(absent));
+    }));
+    add("print to string", mixed, n, measure([&] {
+        bench::keep(std::string(src));
+    }));
+    add("copy", mixed, n, measure([&] {
+        crz::plist l = src;
+        bench::keep(l);
+    }));
+    // 移动出去再移动回来，列表保持不变，不计入析构的时间
+    crz::plist moved = src;
+    add("move (there and back)", mixed, n, measure([&] {
+        crz::plist m = std::move(moved);
+        bench::keep(m);
+        moved = std::move(m);
+    }));
+}
+
+// 读入之前保存的结果，键为"操作,类型,长度"
+std::map<std::string, double> read_baseline(const char *path) {
+    std::map<std::string, double> res;
+    std::ifstream is(path);
+    std::string line;
+    std::getline(is, line); // 表头
+    while (std::getline(is, line)) {
+        std::istringstream ls(line);
+        std::string workload, kind, size, ns;
+        if (std::getline(ls, workload, ',') && std::getline(ls, kind, ',') &&
+            std::getline(ls, size, ',') && std::getline(ls, ns, ','))
+            res[workload + "," + kind + "," + size] = std::atof(ns.c_str());
+    }
+    return res;
+}
+
+}
+
+int main(int argc, char **argv) {
+    const int sizes[] = {16, 1024, 65536};
+    for (int n: sizes) {
+        run(false, n);
+        run(true, n);
+    }
+    if (argc > 2) {
+        auto base = read_baseline(argv[2]);
+        std::printf("\n%-56s %10s\n", "speedup vs baseline", "x");
+        for (auto &r: rows) {
+            auto it = base.find(r.workload + "," + r.kind + "," + std::to_string(r.size));
+            if (it != base.end() && r.r.ns > 0) {
+                std::string name = r.workload + " [" + r.kind + " " + std::to_string(r.size) + "]";
+                std::printf("%-56s %10.2f\n", name.c_str(), it->second / r.r.ns);
+            }
+        }
+    }
+    if (argc > 1) {
+        std::ofstream os(argv[1]);
+        os << "workload,kind,size,ns_per_op,ns_per_elem,allocs_per_op,bytes_per_op\n";
+        for (auto &r: rows)
+            os << r.workload << ',' << r.kind << ',' << r.size << ',' << r.r.ns << ',' << r.r.ns / r.size << ','
+               << r.r.allocs << ',' << r.r.bytes << '\n';
+        std::printf("\nresults written to %s\n", argv[1]);
+    }
+}
@@ -0,0 +1,104 @@
+#include "bench.hh"
+#include "plist.hh"
+#include "plist_variant.hh"
+#include <cstdlib>
+#include <string>
+
+// 类型集合固定的plist_variant和通用的plist对比：同样的元素，分别经过下标分派和pcell的操作表
+using vlist = crz::plist_variant<long long, double, std::string>;
+
+int main() {
+    const int n = 1 << 16;
+    std::srand(233);
+    crz::plist ints, mixed;
+    for (int i = 0; i < n; ++i) {
+        long long x = std::rand() % 10007;
+        ints.push_back(x);
+        if (i % 3 == 0)
+            mixed.push_back(x);
+        else if (i % 3 == 1)
+            mixed.push_back(x * 0.5);
+        else
+            mixed.push_back(std::to_string(x));
+    }
+    const vlist vints(ints), vmixed(mixed);
+    const crz::pcell probe = 233LL;
+    const vlist::cell_type vprobe = 233LL;
+
+    bench::report("plist copy mixed (per element)", bench::time_ns([&] {
+        crz::plist l = mixed;
+        bench::keep(l);
+    }) / n);
+    bench::report("plist_variant copy mixed (per element)", bench::time_ns([&] {
+        vlist l = vmixed;
+        bench::keep(l);
+    }) / n);
+    bench::report("plist count mixed (per element)", bench::time_ns([&] {
+        bench::keep(mixed.count(probe));
+    }) / n);
+    bench::report("plist_variant count mixed (per element)", bench::time_ns([&] {
+        bench::keep(vmixed.count(vprobe));
+    }) / n);
+    bench::report("plist == scan mixed (per element)", bench::time_ns([&] {
+        int cnt = 0;
+        for (int i = 1; i < n; ++i)
+            cnt += mixed[i - 1] == mixed[i];
+        bench::keep(cnt);
+    }) / n);
+    bench::report("plist_variant == scan mixed (per element)", bench::time_ns([&] {
+        int cnt = 0;
+        for (int i = 1; i < n; ++i)
+            cnt += vmixed[i - 1] == vmixed[i];
+        bench::keep(cnt);
+    }) / n);
+    bench::report("plist hash mixed (per element)", bench::time_ns([&] {
+        size_t h = 0;
+        for (const auto &x: mixed)
+            h += x.hash();
+        bench::keep(h);
+    }) / n);
+    bench::report("plist_variant hash mixed (per element)", bench::time_ns([&] {
+        size_t h = 0;
+        for (const auto &x: vmixed)
+            h += x.hash();
+        bench::keep(h);
+    }) / n);
+    bench::report("plist print mixed (per element)", bench::time_ns([&] {
+        bench::keep(std::string(mixed));
+    }) / n);
+    bench::report("plist_variant print mixed (per element)", bench::time_ns([&] {
+        bench::keep(std::string(vmixed));
+    }) / n);
+    bench::report("plist sort ints (per element)", bench::time_ns([&] {
+        crz::plist l = ints;
+        l.sort();
+        bench::keep(l);
+    }) / n);
+    bench::report("plist_variant sort ints (per element)", bench::time_ns([&] {
+        vlist l = vints;
+        l.sort();
+        bench::keep(l);
+    }) / n);
+    bench::report("plist total_order sort mixed (per element)", bench::time_ns([&] {
+        crz::plist l = mixed;
+        l.sort(crz::total_order);
+        bench::keep(l);
+    }) / n);
+    bench::report("plist_variant total_order sort mixed (per element)", bench::time_ns([&] {
+        vlist l = vmixed;
+        l.sort(crz::total_order);
+        bench::keep(l);
+    }) / n);
+    bench::report("plist map ints (per element)", bench::time_ns([&] {
+        bench::keep(const_cast<crz::plist &>(ints).map([](long long x) { return x * 2; }));
+    }) / n);
+    bench::report("plist_variant map ints (per element)", bench::time_ns([&] {
+        bench::keep(vints.map([](long long x) { return x * 2; }));
+    }) / n);
+    bench::report("plist filter mixed (per element)", bench::time_ns([&] {
+        bench::keep(mixed.filter([](const crz::pcell &c) { return c.isa<std::string>(); }));
+    }) / n);
+    bench::report("plist_variant filter mixed (per element)", bench::time_ns([&] {
+        bench::keep(vmixed.filter([](const vlist::cell_type &c) { return c.isa<std::string>(); }));
+    }) / n);
+}
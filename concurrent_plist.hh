@@ -0,0 +1,228 @@
+#ifndef __CRZ_CONCURRENT_PLIST_HH__
+#define __CRZ_CONCURRENT_PLIST_HH__
+
+#include "plist.hh"
+#include <cstdlib>
+
+namespace crz {
+
+// 可以在多个线程中同时追加元素的列表。元素存放在大小倍增的分块中，分块分配后不再移动，
+// 已经追加的元素也不会被移动或修改，因此读者可以在不加锁的情况下访问。
+// 追加时先构造好pcell，再用CAS预留位置并移动进去，不使用互斥锁；
+// 元素按下标顺序发布，snapshot得到的是已发布的前缀，之后追加的元素不会出现在快照中。
+// clear和析构不能和其他操作同时进行
+class concurrent_plist {
+    // 平凡类型，calloc得到的全零内存就是合法的空位。ready用__atomic内建函数原子地读写，
+    // 不用std::atomic<bool>，它需要构造之后才能使用
+    struct slot {
+        bool ready;
+        typename std::aligned_storage<sizeof(pcell), alignof(pcell)>::type buf;
+
+        pcell &cell() noexcept { return *reinterpret_cast<pcell *>(&buf); }
+    };
+    static_assert(std::is_trivial<slot>::value, "slot must be trivial to live in calloc'ed memory");
+
+    static constexpr size_t first_chunk = 64; // 第k个分块的大小为first_chunk << k
+    static constexpr size_t max_chunks = 48;
+
+    std::atomic<slot *> chunks[max_chunks];
+    std::atomic<size_t> reserved{0};  // 已经预留的元素个数
+    std::atomic<size_t> published{0}; // 已经发布的元素个数，下标小于它的元素都已构造完毕
+
+    static size_t chunk_of(size_t i) noexcept {
+        return 63 - __builtin_clzll(i / first_chunk + 1);
+    }
+    static size_t chunk_begin(size_t k) noexcept {
+        return first_chunk * ((size_t(1) << k) - 1);
+    }
+
+    slot &at(size_t i) const noexcept {
+        size_t k = chunk_of(i);
+        return chunks[k].load(std::memory_order_acquire)[i - chunk_begin(k)];
+    }
+
+    // 保证下标在[first, last)中的元素所在的分块都已分配。多个线程同时分配同一个分块时只保留一个
+    void ensure_chunks(size_t first, size_t last) {
+        if (last / first_chunk + 1 >= (size_t(1) << max_chunks))
+            throw std::length_error("concurrent_plist is too long");
+        for (size_t k = chunk_of(first), stop = chunk_of(last - 1); k <= stop; ++k) {
+            if (chunks[k].load(std::memory_order_acquire))
+                continue;
+            // 全零的内存就是未构造的空位，大块的calloc直接使用系统提供的全零页面，不需要逐个初始化
+            auto fresh = static_cast<slot *>(std::calloc(first_chunk << k, sizeof(slot)));
+            if (!fresh)
+                throw std::bad_alloc();
+            slot *expected = nullptr;
+            if (!chunks[k].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel))
+                std::free(fresh);
+        }
+    }
+
+    // 预留连续的n个位置，返回第一个下标。分块在预留之前分配，分配失败时不会留下无法发布的位置
+    size_t reserve_block(size_t n) {
+        size_t i = reserved.load(std::memory_order_relaxed);
+        for (;;) {
+            ensure_chunks(i, i + n);
+            if (reserved.compare_exchange_weak(i, i + n, std::memory_order_relaxed))
+                return i;
+        }
+    }
+
+    // 下标为i的元素是否已构造完毕。所在的分块还未分配时必然未构造
+    bool ready(size_t i) const noexcept {
+        size_t k = chunk_of(i);
+        slot *c = chunks[k].load(std::memory_order_acquire);
+        return c && __atomic_load_n(&c[i - chunk_begin(k)].ready, __ATOMIC_SEQ_CST);
+    }
+
+    // 发布下标为i的已构造完毕的元素，并尽可能向后推进已发布的前缀。
+    // 前缀恰好推进到i时直接推进，否则标记自己已构造完毕，由构造前面元素的线程之后负责推进。
+    // 标记后需要再检查一次前缀，避免前面的线程在标记之前已经检查过这个元素
+    void publish(size_t i) noexcept {
+        size_t p = published.load();
+        if (p != i) {
+            __atomic_store_n(&at(i).ready, true, __ATOMIC_SEQ_CST);
+            p = published.load();
+        }
+        while (p == i || ready(p)) {
+            if (published.compare_exchange_weak(p, p + 1))
+                ++p;
+        }
+    }
+
+public:
+    // 只读的快照，包含创建时已经发布的元素
+    class snapshot_view {
+        const concurrent_plist *owner;
+        size_t len;
+
+    public:
+        class iterator {
+            const concurrent_plist *owner;
+            size_t pos;
+
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = pcell;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const pcell *;
+            using reference = const pcell &;
+
+            iterator(const concurrent_plist *o, size_t p) : owner(o), pos(p) {}
+            const pcell &operator*() const { return owner->at(pos).cell(); }
+            const pcell *operator->() const { return &owner->at(pos).cell(); }
+            const pcell &operator[](difference_type n) const { return owner->at(pos + n).cell(); }
+            iterator &operator++() { return ++pos, *this; }
+            iterator &operator--() { return --pos, *this; }
+            iterator operator++(int) { auto it = *this; return ++pos, it; }
+            iterator operator--(int) { auto it = *this; return --pos, it; }
+            iterator &operator+=(difference_type n) { return pos += n, *this; }
+            iterator &operator-=(difference_type n) { return pos -= n, *this; }
+            friend iterator operator+(iterator it, difference_type n) { return it += n; }
+            friend iterator operator+(difference_type n, iterator it) { return it += n; }
+            friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const iterator &a, const iterator &b) {
+                return static_cast<difference_type>(a.pos) - static_cast<difference_type>(b.pos);
+            }
+            friend bool operator==(const iterator &a, const iterator &b) { return a.pos == b.pos; }
+            friend bool operator!=(const iterator &a, const iterator &b) { return a.pos != b.pos; }
+            friend bool operator<(const iterator &a, const iterator &b) { return a.pos < b.pos; }
+            friend bool operator>(const iterator &a, const iterator &b) { return b < a; }
+            friend bool operator<=(const iterator &a, const iterator &b) { return !(b < a); }
+            friend bool operator>=(const iterator &a, const iterator &b) { return !(a < b); }
+        };
+
+        snapshot_view(const concurrent_plist *o, size_t n) : owner(o), len(n) {}
+
+        size_t size() const { return len; }
+        bool empty() const { return len == 0; }
+        iterator begin() const { return iterator(owner, 0); }
+        iterator end() const { return iterator(owner, len); }
+
+        // 直接索引访问，支持负数索引
+        const pcell &operator[](std::ptrdiff_t i) const {
+            return owner->at(detail::__index_trans(i, len)).cell();
+        }
+
+        size_t count(const pcell &pc) const {
+            return std::count(begin(), end(), pc);
+        }
+        std::ptrdiff_t index(const pcell &pc) const {
+            auto it = std::find(begin(), end(), pc);
+            return it == end() ? -1 : it - begin();
+        }
+
+        plist to_plist() const {
+            return plist(begin(), end());
+        }
+        operator plist() const {
+            return to_plist();
+        }
+
+        friend std::ostream &operator<<(std::ostream &os, const snapshot_view &v) {
+            return os << v.to_plist();
+        }
+    };
+
+    concurrent_plist() {
+        for (auto &c: chunks)
+            c.store(nullptr, std::memory_order_relaxed);
+    }
+    concurrent_plist(const concurrent_plist &) = delete;
+    concurrent_plist &operator=(const concurrent_plist &) = delete;
+    ~concurrent_plist() {
+        clear();
+    }
+
+    // 追加元素，返回其下标。可以在多个线程中同时调用
+    size_t append(pcell pc) {
+        size_t i = reserve_block(1);
+        ::new(static_cast<void *>(&at(i).buf)) pcell(std::move(pc));
+        publish(i);
+        return i;
+    }
+    // 追加pl中的所有元素，这些元素在列表中是连续的
+    void extend(plist pl) {
+        if (pl.empty())
+            return;
+        size_t first = reserve_block(pl.size()), i = first;
+        for (auto &x: pl)
+            ::new(static_cast<void *>(&at(i++).buf)) pcell(std::move(x));
+        for (i = first; i < first + pl.size(); ++i)
+            publish(i);
+    }
+
+    // 已经发布的元素个数
+    size_t size() const {
+        return published.load(std::memory_order_acquire);
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+    // 已发布元素的快照，不阻塞正在追加的线程
+    snapshot_view snapshot() const {
+        return snapshot_view(this, published.load(std::memory_order_acquire));
+    }
+    plist to_plist() const {
+        return snapshot().to_plist();
+    }
+
+    // 清空列表并释放所有分块，不能和其他操作同时进行
+    void clear() noexcept {
+        size_t n = reserved.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < n; ++i)
+            at(i).cell().~pcell();
+        for (auto &c: chunks)
+            std::free(c.exchange(nullptr, std::memory_order_relaxed));
+        reserved.store(0, std::memory_order_relaxed);
+        published.store(0, std::memory_order_relaxed);
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const concurrent_plist &cl) {
+        return os << cl.snapshot();
+    }
+};
+
+}
+
+#endif //__CRZ_CONCURRENT_PLIST_HH__
@@ -1,11 +1,20 @@
 #include <iostream>
 #include "plist.hh"
+#include "plist_of.hh"
+#include "plist_io.hh"
+#include "concurrent_plist.hh"
+#include "plist_variant.hh"
+#include "sorted_plist.hh"
 #include <string>
 #include <functional>
 #include <list>
 #include <utility>
 #include <cstdlib>
 #include <ctime>
+#include <cstdio>
+#include <climits>
+#include <iomanip>
+#include <thread>
 
 std::list<std::pair<const char *, std::function<void(void)>>> test_list;
 
@@ -266,6 +275,787 @@ TEST(some_exception, true) {
     }
 }
 
+struct BigType {
+    double d[8];
+    friend std::ostream &operator<<(std::ostream &os, const BigType &bt) {
+        return os << "Big(" << bt.d[0] << ")";
+    }
+};
+
+TEST(small_object_storage, true) {
+    // int、double、短字符串等小对象直接存放在pcell内部，大对象存放在堆上，两者的行为相同
+    crz::plist l{1, 2.5, std::string("short"), BigType{{1}}};
+    println(l); // [1, 2.5, short, Big(1)]
+    crz::plist r = l;
+    std::swap(r[0], r[3]);
+    std::swap(r[1], r[2]);
+    println(r); // [Big(1), short, 2.5, 1]
+    r.reverse();
+    println(r); // [1, 2.5, short, Big(1)]
+    r[2].cast<std::string &>() += " string that no longer fits in the buffer";
+    println(r[2]); // short string that no longer fits in the buffer
+    println(l[2]); // short
+}
+
+TEST(typed_fast_path, true) {
+    // 元素类型全部相同（算术类型或std::string）时，排序直接在取出的值上进行
+    crz::plist l{3.5, -1.0, 2.25, 0.0, -0.0, 7.0};
+    l.sort();
+    println(l); // [-1, 0, -0, 2.25, 3.5, 7]
+    l.sort(true);
+    println(l); // [7, 3.5, 2.25, 0, -0, -1]
+    // 查找时只比较类型相同的元素，混合类型的列表同样适用
+    crz::plist m{1, 2.0, std::string("2"), 2, 2L, 2};
+    println(m.count(2)); // 2
+    println(m.index(2)); // 3
+    m.remove(2);
+    println(m); // [1, 2, 2, 2]
+}
+
+TEST(sort_key_once, true) {
+    crz::plist l{std::string("10"), std::string("9"), std::string("100"), std::string("09"),
+                 std::string("1")};
+    int calls = 0;
+    // 每个元素只计算一次key；排序是稳定的，key相同的元素保持原来的相对顺序
+    l.sort(false, [&](const std::string &s) {
+        ++calls;
+        return std::stoi(s);
+    });
+    println(l); // [1, 9, 09, 10, 100]
+    println(calls); // 5
+    l.sort(true, [](const std::string &s) { return std::stoi(s); });
+    println(l); // [100, 10, 9, 09, 1]
+}
+
+struct Ranked {
+    int rank;
+    const char *name;
+    friend bool operator<(const Ranked &a, const Ranked &b) {
+        return a.rank < b.rank;
+    }
+    friend std::ostream &operator<<(std::ostream &os, const Ranked &r) {
+        return os << r.name << r.rank;
+    }
+};
+
+TEST(sort_stable_reverse, true) {
+    // 逆序排序同样是稳定的，rank相同的元素保持原来的相对顺序，和python的sort(reverse=True)一致
+    crz::plist l{Ranked{1, "a"}, Ranked{2, "b"}, Ranked{1, "c"}, Ranked{2, "d"}, Ranked{1, "e"}};
+    l.sort(true);
+    println(l); // [b2, d2, a1, c1, e1]
+    l.sort();
+    println(l); // [a1, c1, e1, b2, d2]
+    crz::plist dup(1000, 7);
+    dup.sort(true); // 大量相等的元素
+    println(dup.count(7)); // 1000
+}
+
+TEST(slice_view, true) {
+    crz::plist l{0, 1, 2, 3, 4, 5, 6, 7};
+    // 切片得到的是原列表的视图，不拷贝元素
+    auto v = l[{1, {}, 2}];
+    println(v); // [1, 3, 5, 7]
+    println(v.size()); // 4
+    println(v[-1]); // 7
+    // 对视图再切片，仍然是原列表的视图
+    println(v[{{}, {}, -1}]); // [7, 5, 3, 1]
+    // 通过视图修改原列表中的元素
+    for (auto &x: v)
+        x = x.cast<int>() * 10;
+    v[0] = "one";
+    println(l); // [0, one, 2, 30, 4, 50, 6, 70]
+    // 需要时再转换为新的plist
+    crz::plist copy = l[{-3, {}}];
+    copy.append(8);
+    println(copy); // [50, 6, 70, 8]
+    println(l[{-100, 2}]); // [0, one]
+    // 空的逆序切片，起点不在列表范围内
+    crz::plist empty;
+    auto ev = empty[{{}, {}, -1}];
+    println(ev.begin() == ev.end()); // 1
+    println(ev.start()); // 0
+    println(l[{-100, {}, -1}]); // []
+    println(crz::plist(l[{-100, {}, -1}]).size()); // 0
+}
+
+TEST(slice_assign_and_delete, true) {
+    crz::plist l{0, 1, 2, 3, 4, 5, 6, 7};
+    // l[1:3] = ["a", "b", "c"]，步长为1时长度可以不同
+    l[{1, 3}] = {"a", "b", "c"};
+    println(l); // [0, a, b, c, 3, 4, 5, 6, 7]
+    // l[1:4] = []
+    l[{1, 4}] = crz::plist{};
+    println(l); // [0, 3, 4, 5, 6, 7]
+    // l[::2] = l[1::2]，步长不为1时长度必须相同
+    l[{{}, {}, 2}] = l[{1, {}, 2}];
+    println(l); // [3, 3, 5, 5, 7, 7]
+    try {
+        l[{{}, {}, 2}] = {1, 2};
+    } catch (std::invalid_argument &e) {
+        println(e.what()); // attempt to assign sequence of size 2 to extended slice of size 3
+    }
+    // del l[::2]
+    crz::plist m{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    m.erase({{}, {}, 2});
+    println(m); // [1, 3, 5, 7, 9]
+    // del l[::-2]
+    m.erase({{}, {}, -2});
+    println(m); // [3, 7]
+    // del l[:1]
+    m.erase({{}, 1});
+    println(m); // [7]
+}
+
+struct Counted {
+    static int copies;
+    int x;
+    Counted(int x) : x(x) {}
+    Counted(const Counted &c) : x(c.x) { ++copies; }
+    Counted(Counted &&c) noexcept: x(c.x) {}
+    friend std::ostream &operator<<(std::ostream &os, const Counted &c) {
+        return os << "C" << c.x;
+    }
+};
+
+int Counted::copies = 0;
+
+TEST(move_concat, true) {
+    auto make = [](int n) {
+        crz::plist l;
+        for (int i = 0; i < n; ++i)
+            l.append(Counted(i));
+        return l;
+    };
+    crz::plist a = make(2), b = make(3), c = make(1);
+    Counted::copies = 0;
+    // 即将销毁的列表中的元素直接移动，不再拷贝
+    crz::plist l = std::move(a) + std::move(b);
+    println(l); // [C0, C1, C0, C1, C2]
+    l.extend(std::move(c));
+    crz::plist r = std::move(l) * 2; // 只有复制出来的6个元素需要拷贝
+    println(r); // [C0, C1, C0, C1, C2, C0, C0, C1, C0, C1, C2, C0]
+    println(Counted::copies); // 6
+    println(r * 0); // []
+}
+
+TEST(memory_resource, true) {
+    crz::arena_resource arena;
+    {
+        // 作用域内新建的大对象都从arena中分配，只需移动指针
+        crz::resource_scope scope(&arena);
+        crz::plist tmp;
+        for (int i = 0; i < 3; ++i)
+            tmp.append(BigType{{double(i)}});
+        tmp += tmp;
+        println(tmp); // [Big(0), Big(1), Big(2), Big(0), Big(1), Big(2)]
+    }
+    arena.release(); // 一次性释放所有内存
+
+    crz::pool_resource pool;
+    crz::pcell c(std::allocator_arg, &pool, BigType{{2.5}});
+    crz::pcell d = c; // 离开作用域后的拷贝仍使用默认的new和delete
+    println(d); // Big(2.5)
+}
+
+TEST(parallel_operator, true) {
+    crz::plist l;
+    std::srand(233);
+    for (int i = 0; i < 10000; ++i)
+        l.push_back(std::rand() % 100);
+    crz::par pol(4, 100); // 4个线程，每个任务处理100个元素
+    // 并行版本的结果和串行版本完全相同
+    println(l.map(pol, [](int x) { return x * 2; }) == l.map([](int x) { return x * 2; })); // 1
+    println(l.filter(pol, [](int x) { return x % 3 == 0; }) == l.filter([](int x) { return x % 3 == 0; })); // 1
+    crz::plist keyed = l, serial = l;
+    keyed.sort(pol, true, [](int x) { return x % 10; });
+    serial.sort(true, [](int x) { return x % 10; });
+    println(keyed == serial); // 1
+    // key的类型不需要有默认构造函数
+    struct Key {
+        int v;
+        explicit Key(int v) : v(v) {}
+        bool operator<(const Key &k) const { return v < k.v; }
+    };
+    keyed.sort(pol, false, [](int x) { return Key(x % 10); });
+    serial.sort(false, [](int x) { return Key(x % 10); });
+    println(keyed == serial); // 1
+    crz::plist generic = l.map([](int x) { return std::make_pair(x % 7, x); });
+    crz::plist generic_serial = generic;
+    generic.sort(pol);
+    generic_serial.sort();
+    println(generic == generic_serial); // 1
+    crz::plist sorted = l;
+    sorted.sort(pol);
+    println(sorted[{{}, 5}]); // [0, 0, 0, 0, 0]
+    // arena不是线程安全的，在其作用域内执行并行操作时，工作线程不从arena中分配，而是使用默认的new和delete
+    struct Big {
+        double d[16];
+        bool operator==(const Big &b) const { return d[0] == b.d[0]; }
+    };
+    crz::arena_resource arena;
+    {
+        crz::resource_scope scope(&arena);
+        crz::plist big = l.map(pol, [](int x) { return Big{{double(x)}}; });
+        println(big == l.map([](int x) { return Big{{double(x)}}; })); // 1
+        auto small = [](const Big &b) { return b.d[0] < 50; };
+        println(big.filter(pol, small) == big.filter(small)); // 1
+        big.clear();
+    }
+    // 线程安全的资源沿用到工作线程中
+    struct SharedResource : crz::memory_resource {
+        std::atomic<int> allocs{0};
+        void *allocate(size_t bytes, size_t) override { return ++allocs, ::operator new(bytes); }
+        void deallocate(void *p, size_t, size_t) noexcept override { ::operator delete(p); }
+        bool thread_safe() const noexcept override { return true; }
+    } shared;
+    {
+        crz::resource_scope scope(&shared);
+        crz::plist big = l.map(pol, [](int x) { return Big{{double(x)}}; });
+        println(shared.allocs.load()); // 10000
+    }
+    l.for_each(pol, [](int &x) { x = -x; });
+    println(l.count(0) + l.filter([](int x) { return x < 0; }).size()); // 10000
+}
+
+TEST(lazy_list, true) {
+    crz::plist l{1, 2, 3, 4, 5, 6, 7, 8};
+    // 整条操作链只遍历一遍l，也不产生中间列表，直到collect才生成新的列表
+    println(l.lazy()
+             .filter([](int x) { return x % 2 == 0; })
+             .map([](int x) { return x * 10; })
+             .map([](int x) { return std::to_string(x) + "!"; })
+             .collect()); // [20!, 40!, 60!, 80!]
+    println(l.lazy().skip(2).take(3).collect()); // [3, 4, 5]
+    println(l.lazy().map([](int x) { return x * x; })
+             .reduce(0, [](int acc, int x) { return acc + x; })); // 204
+    crz::plist names{"Reimu", "Marisa", "Sanae"};
+    println(names.lazy().enumerate(1).collect()); // [(1, Reimu), (2, Marisa), (3, Sanae)]
+    println(l.lazy().zip(names).collect()); // [(1, Reimu), (2, Marisa), (3, Sanae)]
+    println(l.lazy().filter([](int x) { return x > 5; }).count()); // 3
+}
+
+TEST(hash_operator, true) {
+    crz::plist a{1, 2, std::string("???"), 2, 3.5, 1, std::string("???")};
+    crz::plist b{2, 3.5, 4, std::string("!!!")};
+    println(a.unique()); // [1, 2, ???, 3.5]
+    println(a.intersect(b)); // [2, 3.5]
+    println(a.difference(b)); // [1, ???]
+    println(std::hash<crz::pcell>()(crz::pcell(std::string("wow"))) == std::hash<std::string>()("wow")); // 1
+    // 建立哈希索引后，反复的查找不再需要遍历列表
+    auto idx = a.hash_index();
+    println(idx.index(std::string("???"))); // 2
+    println(idx.count(2)); // 2
+    println(idx.contains(2.0)); // 0
+    println(idx.size()); // 4
+    try {
+        crz::plist{UserType{1}}.unique(); // UserType未特化std::hash
+    } catch (crz::bad_pcell_hash &e) {
+        println(e.what()); // unhashable type: 8UserType
+    }
+}
+
+TEST(binary_serialization, true) {
+    // 用户类型需要注册编号和读写函数
+    crz::register_type<UserType>(256,
+                                 [](crz::oarchive &ar, const UserType &ut) { ar.write_pod(ut.x); },
+                                 [](crz::iarchive &ar) { return UserType{ar.read_pod<int>()}; });
+    crz::plist l{1, 2.5, std::string("???"), "wow", crz::plist{true, crz::pcell()}, UserType{3}};
+    std::stringstream ss;
+    crz::dump(l, ss);
+    println(crz::load(ss)); // [1, 2.5, ???, wow, [1, None], User(3)]
+    // 每个元素只写出一次，嵌套的列表同样不会重复调用用户类型的写出函数
+    struct Counted {};
+    static int writes = 0;
+    crz::register_type<Counted>(257,
+                                [](crz::oarchive &ar, const Counted &) { ++writes, ar.write_pod(0); },
+                                [](crz::iarchive &ar) { return ar.read_pod<int>(), Counted{}; });
+    std::stringstream counted;
+    crz::dump(crz::plist{Counted{}, crz::plist{crz::plist{Counted{}}, Counted{}}}, counted);
+    println(writes); // 3
+    println(crz::load(counted)[1].cast<const crz::plist &>().size()); // 2
+    // 可以定位的输出流随写随出，不能定位时先放在缓冲区中，两者写出的内容相同
+    struct pipe_buf : std::streambuf {
+        std::string data;
+        int_type overflow(int_type c) override { return data.push_back(char(c)), c; }
+        std::streamsize xsputn(const char *s, std::streamsize k) override { return data.append(s, k), k; }
+    } pipe;
+    std::ostream piped(&pipe);
+    crz::plist large;
+    for (int i = 0; i < 3000; ++i)
+        large.push_back(crz::plist{std::string(30, 'a' + i % 26), i, crz::plist{}});
+    large.push_back(crz::plist(20000, 1));
+    std::stringstream seekable;
+    crz::dump(large, seekable);
+    crz::dump(large, piped);
+    println(seekable.str() == pipe.data); // 1
+    println(crz::load(seekable) == large); // 1
+    // 损坏的数据：字符串的长度远超过剩余的数据
+    std::stringstream corrupt;
+    crz::dump(crz::plist{std::string("abc")}, corrupt);
+    std::string bytes = corrupt.str();
+    uint64_t huge = uint64_t(1) << 40;
+    std::memcpy(&bytes[bytes.size() - 3 - sizeof(huge)], &huge, sizeof(huge));
+    try {
+        std::istringstream is(bytes);
+        crz::load(is);
+    } catch (crz::bad_serialization &e) {
+        println(e.what()); // bad serialization: unexpected end of data
+    }
+    // 映射加载：元素在第一次访问时才构造
+    const char *path = "plist_io_test.bin";
+    crz::dump(l, path);
+    {
+        crz::mapped_plist ml(path);
+        println(ml.size()); // 6
+        println(ml.get<double>(1)); // 2.5
+        auto s = ml.string_at(3);
+        println(std::string(s.first, s.second)); // wow
+        println(ml.sub(4)[1]); // None
+        println(ml[-1]); // User(3)
+        try {
+            ml.get<int>(2);
+        } catch (crz::bad_pcell_cast &e) {
+            println(e.what()); // bad pcell cast: from NSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEE to i
+        }
+    }
+    std::remove(path);
+}
+
+TEST(buffer_output, true) {
+    crz::plist l{1, -2.5, 1e20, 0.1, 'c', true, LLONG_MIN, std::string("???"), "wow", crz::plist{crz::plist{}, UserType{1}}, crz::pcell()};
+    crz::pbuffer buf; // 可以反复使用的缓冲区
+    l.write_to(buf);
+    println(buf.str()); // [1, -2.5, 1e+20, 0.1, c, 1, -9223372036854775808, ???, wow, [[], User(1)], None]
+    println(std::string(l) == buf.str()); // 1
+    // 深度嵌套的列表不会导致递归过深
+    crz::plist deep;
+    for (int i = 0; i < 10000; ++i) {
+        crz::plist outer;
+        outer.push_back(std::move(deep));
+        deep = std::move(outer);
+    }
+    buf.clear();
+    deep.write_to(buf);
+    println(buf.size()); // 20002
+    // 输出流不是默认格式时，遵从流的设置
+    std::cout << std::setprecision(3) << crz::plist{3.14159, 2} << std::setprecision(6) << std::endl; // [3.14, 2]
+    // 空的字符串指针不输出任何字符
+    buf.clear();
+    crz::plist{static_cast<const char *>(nullptr), 1}.write_to(buf);
+    println(buf.str()); // [, 1]
+    // 直接写入文件
+    std::cout.flush();
+    {
+        crz::pbuffer out(stdout);
+        l[{{}, 3}].to_plist().write_to(out);
+        out.append('\n');
+    } // [1, -2.5, 1e+20]
+}
+
+TEST(copy_on_write, true) {
+    crz::cow_plist inner{1, 2, 3};
+    crz::cow_plist outer{inner, std::string("???")};
+    // 拷贝只增加引用计数，嵌套的列表同样共享
+    crz::cow_plist copy = outer;
+    println(outer.use_count()); // 2
+    println(inner.use_count()); // 2
+    // 第一次修改时才拷贝，其他副本不受影响
+    copy.append(4);
+    println(outer.use_count()); // 1
+    println(inner.use_count()); // 3
+    copy[0].cast<crz::cow_plist &>()[0] = 100;
+    println(copy); // [[100, 2, 3], ???, 4]
+    println(outer); // [[1, 2, 3], ???]
+    println(inner.use_count()); // 2
+    println(outer == crz::cow_plist{crz::cow_plist{1, 2, 3}, std::string("???")}); // 1
+    // 交出可写的引用之后，再拷贝时深拷贝，通过引用的修改不会影响到拷贝
+    crz::cow_plist a{1, 2};
+    crz::pcell &r = a[0];
+    crz::cow_plist b = a;
+    r = 5;
+    println(a); // [5, 2]
+    println(b); // [1, 2]
+    println(b.use_count()); // 1
+    // 清空之后可以重新共享
+    a.clear();
+    a.append(3);
+    crz::cow_plist c = a;
+    println(a.use_count()); // 2
+}
+
+TEST(concurrent_list, true) {
+    crz::concurrent_plist cl;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&cl, t] {
+            for (int i = 0; i < 1000; ++i)
+                cl.append(t * 1000 + i);
+        });
+    }
+    // 读者不需要加锁，快照中的元素个数只会增加
+    bool monotonic = true;
+    for (size_t last = 0, k = 0; k < 100; ++k) {
+        auto snap = cl.snapshot();
+        monotonic = monotonic && snap.size() >= last;
+        last = snap.size();
+    }
+    for (auto &w: writers)
+        w.join();
+    println(monotonic); // 1
+    println(cl.size()); // 4000
+    cl.extend(crz::plist{-1, -2});
+    auto snap = cl.snapshot();
+    println(snap[{-2}]); // -1
+    crz::plist all = snap;
+    all.sort();
+    println(all[{{}, 4}]); // [-2, -1, 0, 1]
+    println(all.unique().size()); // 4002
+}
+
+TEST(non_throwing_operator, true) {
+    crz::plist l{3, 2.5, "wow", std::string("abc"), crz::pcell(), UserType{1}, -1, std::string("ab"), NAN};
+    // try_cast类型不符时返回空指针，不抛出异常
+    if (auto p = l[0].try_cast<int>())
+        println(*p); // 3
+    println(l[0].try_cast<double>() == nullptr); // 1
+    println(l[4].try_cast<int>() == nullptr); // 1
+    *l[1].try_cast<double>() += 1;
+    println(l[1]); // 3.5
+    // 三路比较，算术类型之间按数值比较
+    println(l[0].compare(l[1]) == crz::ordering::less); // 1
+    println(l[6].compare(crz::pcell(-1.0)) == crz::ordering::equal); // 1
+    println(l[3].compare(l[7]) == crz::ordering::greater); // 1
+    println(l[0].compare(l[3]) == crz::ordering::incomparable); // 1
+    println(l[5].compare(l[5]) == crz::ordering::incomparable); // 1
+    println(l[8].compare(l[8]) == crz::ordering::incomparable); // 1
+    println(l[4].compare(crz::pcell()) == crz::ordering::equal); // 1
+    // 全序排序：空值、数值（NaN在最后）、其他类型按类型名（typeid(T).name()）分组
+    l.sort(crz::total_order);
+    println(l); // [None, -1, 3, 3.5, nan, User(1), ab, abc, wow]
+    l.sort(crz::total_order, true);
+    println(l); // [wow, abc, ab, User(1), nan, 3.5, 3, -1, None]
+    crz::plist ints{5, 3, 4};
+    println(ints.sort(crz::total_order)); // [3, 4, 5]
+    // 嵌套的列表按字典序逐个比较元素，同样不抛出异常
+    crz::pcell a = crz::plist{1}, b = crz::plist{std::string("a")}, c = crz::plist{crz::pcell()};
+    println(a.compare(b) == crz::ordering::incomparable); // 1
+    println(c.compare(c) == crz::ordering::equal); // 1
+    println(a.compare(crz::plist{1, 0}) == crz::ordering::less); // 1
+    println(crz::plist{1}.compare(crz::plist{std::string("a")}, crz::total_order) == crz::ordering::less); // 1
+    crz::plist nested{crz::plist{1}, crz::plist{"a"}, 3, crz::plist{0.5, crz::plist{}}, crz::plist{crz::pcell()}};
+    println(nested.sort(crz::total_order)); // [3, [None], [0.5, []], [1], [a]]
+    // 类型自身的<抛出的异常原样传出，全序排序时列表保持不变
+    struct Picky {
+        int v;
+        bool operator<(const Picky &p) const {
+            if (v < 0 || p.v < 0)
+                throw std::domain_error("negative");
+            return v < p.v;
+        }
+    };
+    crz::plist picky{Picky{2}, Picky{-1}, Picky{1}};
+    try {
+        picky[0].compare(picky[1]);
+    } catch (std::domain_error &e) {
+        println(e.what()); // negative
+    }
+    try {
+        picky.sort(crz::total_order);
+    } catch (std::domain_error &e) {
+        println(e.what()); // negative
+    }
+    println(picky[1].cast<Picky>().v); // -1
+}
+
+// 统计拷贝、移动，以及pcell在堆上的分配次数
+struct Tracked {
+    static int copies, moves;
+    double d[8];
+    Tracked(int x, double y = 0) : d{double(x), y} {}
+    Tracked(const Tracked &t) { std::copy(t.d, t.d + 8, d), ++copies; }
+    Tracked(Tracked &&t) noexcept { std::copy(t.d, t.d + 8, d), ++moves; }
+    friend std::ostream &operator<<(std::ostream &os, const Tracked &t) {
+        return os << "T" << t.d[0];
+    }
+};
+
+int Tracked::copies = 0, Tracked::moves = 0;
+
+struct CountingResource : crz::memory_resource {
+    int allocs = 0;
+    void *allocate(size_t bytes, size_t) override {
+        return ++allocs, ::operator new(bytes);
+    }
+    void deallocate(void *p, size_t, size_t) noexcept override {
+        ::operator delete(p);
+    }
+};
+
+TEST(emplace_operator, true) {
+    CountingResource res;
+    crz::resource_scope scope(&res);
+    crz::plist l;
+    l.reserve(8);
+    // 临时对象移动进pcell，pcell再移动进列表，不拷贝
+    l.append(Tracked(1));
+    println(Tracked::copies); // 0
+    println(Tracked::moves); // 1
+    // 原位构造，不拷贝也不移动
+    Tracked::moves = 0;
+    l.emplace_back<Tracked>(2, 0.5);
+    l.emplace<Tracked>(l.begin(), 0);
+    l.insert(-1, Tracked(3));
+    l.insert(100, crz::pcell(crz::in_place_type_t<Tracked>(), 4));
+    println(l); // [T0, T1, T3, T2, T4]
+    println(Tracked::copies); // 0
+    println(Tracked::moves); // 1
+    // 每次插入只分配一次
+    println(res.allocs); // 5
+    // 原位替换pcell中的对象
+    crz::pcell c = 1;
+    c.emplace<std::string>(3, 'x');
+    println(c); // xxx
+    println(l[-1].emplace<Tracked>(5).d[0]); // 5
+    println(res.allocs); // 6
+    l.emplace_back(std::string("wow"));
+    l.append(std::string("short"));
+    println(l.count(std::string("wow"))); // 1
+    println(l[{-3, {}}]); // [T5, wow, short]
+    println(Tracked::copies); // 0
+}
+
+TEST(compaction, true) {
+    crz::plist l;
+    for (int i = 0; i < 8; ++i)
+        l.append(BigType{{double(i)}});
+    l.append(crz::plist{BigType{{8}}, BigType{{9}}});
+    l.sort(true, [](const crz::pcell &c) { return c.isa<BigType>() ? c.cast<const BigType &>().d[0] : -1; });
+    println(l); // [Big(7), Big(6), Big(5), Big(4), Big(3), Big(2), Big(1), Big(0), [Big(8), Big(9)]]
+    // 整理后堆上的对象按列表顺序相邻存放，嵌套的列表紧随其后
+    l.compact();
+    auto addr = [](const crz::pcell &c) { return reinterpret_cast<uintptr_t>(&c.cast<const BigType &>()); };
+    bool ordered = true;
+    for (int i = 1; i < 8; ++i)
+        ordered = ordered && addr(l[i]) > addr(l[i - 1]) && addr(l[i]) - addr(l[i - 1]) < 2 * sizeof(BigType);
+    const auto &inner = l[-1].cast<const crz::plist &>();
+    ordered = ordered && addr(inner[0]) > addr(l[7]) && addr(inner[1]) > addr(inner[0]);
+    println(ordered); // 1
+    println(l); // [Big(7), Big(6), Big(5), Big(4), Big(3), Big(2), Big(1), Big(0), [Big(8), Big(9)]]
+    // 整理后的对象可以比列表活得更久
+    crz::pcell kept = std::move(l[0]);
+    crz::plist copy = l;
+    l.clear();
+    println(kept); // Big(7)
+    println(copy[{1, 3}]); // [Big(6), Big(5)]
+    // 在作用域内排序后自动整理
+    crz::auto_compact_scope scope(4);
+    copy.sort(false, [](const crz::pcell &c) { return c.isa<BigType>() ? c.cast<const BigType &>().d[0] : 100; });
+    ordered = true;
+    for (int i = 1; i < 7; ++i)
+        ordered = ordered && addr(copy[i]) > addr(copy[i - 1]);
+    println(ordered); // 1
+    println(copy); // [Big(0), Big(1), Big(2), Big(3), Big(4), Big(5), Big(6), None, [Big(8), Big(9)]]
+}
+
+TEST(columnar_list, true) {
+    // 元素类型都为double时按列存储在连续的内存中，归约操作使用SIMD指令
+    crz::plist_of<double> l{1.5, 2.5, -3.0, 4.0, 10.0, 0.5, 7.0, 8.0, 9.0, 1.0};
+    println(l.sum()); // 40.5
+    println(l.min()); // -3
+    println(l.max()); // 10
+    println(l.mean()); // 4.05
+    println(l.count(1.0)); // 1
+    println(l[{{}, 3}]); // [1.5, 2.5, -3]
+    l.sort(true);
+    println(l); // [10, 9, 8, 7, 4, 2.5, 1.5, 1, 0.5, -3]
+    println(l.boxed()); // 0
+    // 放入其他类型的元素时，转换为通用的存储
+    l.append("wow");
+    println(l.boxed()); // 1
+    println(l[-2]); // -3
+    println(l.to_plist()[{-3, {}}]); // [0.5, -3, wow]
+    try {
+        l.sum();
+    } catch (crz::bad_pcell_cast &e) {
+        println(e.what()); // bad pcell cast: from PKc to d
+    }
+    // 索引访问返回元素的拷贝，不能对其赋值，修改元素使用set
+    static_assert(!std::is_assignable<decltype(l[0]), crz::pcell>::value, "plist_of::operator[] is read-only");
+    l.set(0, 11.0);
+    println(l[0]); // 11
+    // 平均值在double中累加，整数的和超出int的范围也不会溢出
+    std::vector<int> ints(20, INT_MAX);
+    crz::plist_of<int> big(ints.begin(), ints.end());
+    println(big.mean() == INT_MAX); // 1
+    big.append("wow");
+    big.pop_back();
+    println(big.boxed()); // 1
+    println(big.mean() == INT_MAX); // 1
+}
+
+TEST(variant_list, true) {
+    // 元素类型限定在给定的几种类型中，直接存放在列表中，操作按类型下标分派
+    using vlist = crz::plist_variant<long long, double, std::string, crz::plist>;
+    vlist l{3, 1.5, "wow", 2, crz::plist{1, 2}};
+    println(l); // [3, 1.5, wow, 2, [1, 2]]
+    println(sizeof(vlist::cell_type) <= 40); // 1
+    println(l[-1].index()); // 3
+    println(l[2].cast<std::string>()); // wow
+    println(l[{1, {}, 2}]); // [1.5, 2]
+    println(l.count(3)); // 1
+    println(l.index("wow")); // 2
+    println(l[0] == 3); // 1
+    println(l[0] == 3.0); // 0
+    println(l[0].compare(3.0) == crz::ordering::equal); // 1
+    println(l[0].hash() == crz::pcell(3LL).hash()); // 1
+    try {
+        l.sort();
+    } catch (crz::bad_comparison &e) {
+        println(e.what()); // bad comparison: x < d
+    }
+    println(l); // [3, 1.5, wow, 2, [1, 2]]
+    l.sort(crz::total_order);
+    println(l); // [1.5, 2, 3, wow, [1, 2]]
+    l.remove(crz::plist{1, 2});
+    // 类型都相同时只分派一次，直接对值排序
+    vlist nums = l.filter([](const vlist::cell_type &c) { return !c.isa<std::string>(); });
+    nums = nums.map([](const vlist::cell_type &c) { return c.isa<double>() ? c.cast<double>() * 4 : c.cast<long long>() * 2.0; });
+    println(nums.sort(true)); // [6, 6, 4]
+    // 类型相同而值之间的比较抛出异常时，列表同样保持不变
+    vlist nested{crz::plist{1, 2}, crz::plist{"a"}, crz::plist{3}};
+    try {
+        nested.sort();
+    } catch (crz::bad_comparison &e) {
+        println(e.what()); // bad comparison: PKc < i
+    }
+    println(nested); // [[1, 2], [a], [3]]
+    vlist strs{"b", "c", "a"};
+    println(strs.sort(false, [](const std::string &s) { return s; })); // [a, b, c]
+    // 和plist相互转换，整数、浮点数和字符串字面量的转换规则和构造函数相同，其他不在类型列表中的类型抛出bad_pcell_cast
+    crz::plist pl = l.to_plist();
+    println(pl[0].isa<double>()); // 1
+    println(vlist(pl) == l); // 1
+    vlist promoted(crz::plist{1, "x", 2.5f});
+    println(promoted); // [1, x, 2.5]
+    println(promoted[0].isa<long long>() && promoted[1].isa<std::string>() && promoted[2].isa<double>()); // 1
+    try {
+        vlist bad(crz::plist{'c'});
+    } catch (crz::bad_pcell_cast &e) {
+        println(e.what()); // bad pcell cast: from c to N3crz12variant_cellIJxdNSt7__cxx1112basic_stringIcSt11char_traitsIcESaIcEEENS_5plistEEEE
+    }
+}
+
+TEST(wide_index, true) {
+    // 下标和切片都是std::ptrdiff_t，超出int范围的起点、终点和步长同样按python的规则截断
+    crz::plist l{0, 1, 2, 3, 4, 5};
+    const std::ptrdiff_t big = std::ptrdiff_t(1) << 40;
+    println(l[{-big, big}]); // [0, 1, 2, 3, 4, 5]
+    println(l[{big, -big, -2}]); // [5, 3, 1]
+    println(l[{{}, {}, PTRDIFF_MIN}]); // [5]
+    // 空的逆序切片，起点截断为-1，视图的起点不在列表之外
+    println(l[{-big, {}, -1}]); // []
+    println(l[{-big, {}, -1}].start()); // 0
+    println(l[{{}, {}, PTRDIFF_MIN}][{-big, {}, -1}]); // []
+    // 步长之积会溢出的嵌套切片
+    println(l[{{}, {}, big}][{{}, {}, -big}]); // [0]
+    // 正数越界同样抛出异常
+    try {
+        println(l[6]);
+    } catch (std::out_of_range &e) {
+        println(e.what()); // index out of range
+    }
+    try {
+        println(l[PTRDIFF_MIN]);
+    } catch (std::out_of_range &e) {
+        println(e.what()); // index out of range
+    }
+    l.insert(-big, -1);
+    l.insert(big, 6);
+    println(l); // [-1, 0, 1, 2, 3, 4, 5, 6]
+    println(l.index(6)); // 7
+    // 长度为1的扩展切片，赋值时长度仍必须相同
+    try {
+        l[{{}, {}, big}] = crz::plist{7, 8};
+    } catch (std::invalid_argument &e) {
+        println(e.what()); // attempt to assign sequence of size 2 to extended slice of size 1
+    }
+}
+
+TEST(sorted_list, true) {
+    // 始终有序的列表，二分查找定位，批量插入时只排序新元素再线性合并
+    crz::sorted_plist l(crz::plist{5, 1, 4});
+    l.insort(3);
+    l.insert_many(crz::plist{6, 0, 3, 2});
+    println(l); // [0, 1, 2, 3, 3, 4, 5, 6]
+    println(l.bisect_left(3)); // 3
+    println(l.bisect_right(3)); // 5
+    println(l.contains(4)); // 1
+    println(l.contains(7)); // 0
+    println(l.index(5)); // 6
+    println(l.count(3)); // 2
+    l.remove(3);
+    println(l[{{}, 4}]); // [0, 1, 2, 3]
+    println(merge(l, crz::sorted_plist(crz::plist{-1, 3, 10}))); // [-1, 0, 1, 2, 3, 3, 4, 5, 6, 10]
+    // key函数对每个元素只计算一次；key相等的元素保持放入的顺序
+    int calls = 0;
+    crz::sorted_plist words([&calls](const std::string &s) { return ++calls, s.length(); });
+    words.insert_many(crz::plist{std::string("Sakuya"), std::string("Reimu"), std::string("Marisa")});
+    words.insort(std::string("Sanae"));
+    println(words); // [Reimu, Sanae, Sakuya, Marisa]
+    println(words.bisect_left(size_t(6))); // 2
+    println(words.index(std::string("Marisa"))); // 3
+    println(calls); // 5
+    try {
+        l.insort("wow");
+    } catch (crz::bad_comparison &e) {
+        println(e.what()); // bad comparison: PKc < i
+    }
+    println(l.size()); // 7
+}
+
+#ifdef CRZ_PLIST_STATS
+TEST(instrumentation, true) {
+    // 用make CXXFLAGS="-Wall -O2 -std=c++11 -DCRZ_PLIST_STATS"编译时才运行
+    crz::stats_reset();
+    auto base = crz::stats_snapshot();
+    // 放不进pcell内部缓冲区的对象存放在堆上，拷贝时需要分配
+    struct Big {
+        double v[8];
+    };
+    crz::plist l{Big{}, 1, 2.5};
+    crz::plist copy;
+    {
+        CRZ_STATS_SCOPE("copy list");
+        copy = l;
+    }
+    auto s = crz::stats_snapshot();
+    println(s.enabled); // 1
+    println(s.sites.size()); // 1
+    println(s.sites[0].name); // copy list
+    println(s.sites[0].clones); // 3
+    println(s.sites[0].allocations); // 1
+    println(s.live_cells - base.live_cells); // 6
+    try {
+        copy.sort();
+    } catch (crz::bad_comparison &e) {
+        println(e.what()); // bad comparison: i < Z20test_instrumentationvE3Big
+    }
+    crz::plist ints{3, 1, 2};
+    ints.map([](int x) { return x; });
+    s = crz::stats_snapshot();
+    println(s.sort.calls); // 1
+    println(s.map.calls); // 1
+    size_t bad = 0;
+    for (const auto &t: s.types) {
+        bad += t.bad_comparisons;
+        if (t.type == typeid(int).name())
+            println(t.casts); // 3
+    }
+    println(bad); // 1
+    crz::stats_dump(std::cout);
+}
+#endif
+
 void run_all_test() {
     for (auto &t: test_list) {
         std::cout << "test: " << t.first << std::endl;
@@ -12,11 +12,29 @@
 #include <stdexcept>
 #include <sstream>
 #include <tuple>
+#include <new>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <unordered_set>
+#include <unordered_map>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+#include <system_error>
 
-namespace crz {
+#ifdef CRZ_PLIST_STATS
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#endif
 
-// 格式化字符串的极简实现
-#define format(__stream) (dynamic_cast<std::ostringstream & >(std::ostringstream() __stream).str())
+namespace crz {
 
 // 以下为一些自定义的异常
 
@@ -25,7 +43,7 @@ class bad_comparison : public std::logic_error {
 public:
     explicit bad_comparison(const std::type_info &lhs, const std::type_info &rhs, const char *opt) :
             std::logic_error(
-                    format(<< "bad comparison: "<< lhs.name() << " " << opt << " " << rhs.name())) {}
+                    std::string("bad comparison: ") + lhs.name() + " " + opt + " " + rhs.name()) {}
 };
 
 // 访问一个空值
@@ -39,9 +57,460 @@ class bad_pcell_cast : public std::logic_error {
 public:
     bad_pcell_cast(const std::type_info &from, const std::type_info &to) :
             std::logic_error(
-                    format(<< "bad pcell cast: from "<< from.name() << " to " << to.name())) {}
+                    std::string("bad pcell cast: from ") + from.name() + " to " + to.name()) {}
+};
+
+// 对不能哈希的对象求哈希值
+class bad_pcell_hash : public std::logic_error {
+public:
+    explicit bad_pcell_hash(const std::type_info &info) :
+            std::logic_error(
+                    std::string("unhashable type: ") + info.name()) {}
+};
+
+// pcell::compare的结果。类型不同、其中一方为空、类型不支持比较或者值之间无法比较（例如NaN）时为incomparable
+enum class ordering {
+    less, equal, greater, incomparable
+};
+
+
+// 可以反复使用的字符缓冲区，列表的输出先写入这里，不经过std::ostream。
+// 给出文件时，缓冲的内容达到上限后用std::fwrite写入该文件，析构时写入剩余的内容。
+// 文件描述符可以先用fdopen得到FILE *
+class pbuffer {
+    std::string buf;
+    std::FILE *file{nullptr};
+    size_t limit{0};
+
+public:
+    pbuffer() = default;
+    explicit pbuffer(std::FILE *file, size_t limit = 1 << 16) : file(file), limit(limit) {
+        buf.reserve(limit);
+    }
+    pbuffer(const pbuffer &) = delete;
+    pbuffer &operator=(const pbuffer &) = delete;
+    ~pbuffer() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    const char *data() const noexcept { return buf.data(); }
+    size_t size() const noexcept { return buf.size(); }
+    bool empty() const noexcept { return buf.empty(); }
+    // 清空内容，保留已经分配的空间
+    void clear() noexcept { buf.clear(); }
+    std::string str() const { return buf; }
+
+    pbuffer &append(const char *s, size_t n) {
+        buf.append(s, n);
+        if (file && buf.size() >= limit)
+            flush();
+        return *this;
+    }
+    pbuffer &append(const char *s) {
+        return append(s, std::strlen(s));
+    }
+    pbuffer &append(const std::string &s) {
+        return append(s.data(), s.size());
+    }
+    pbuffer &append(char c) {
+        return append(&c, 1);
+    }
+    // 数值的转换直接写入栈上的数组，输出的格式和std::ostream的默认格式相同
+    pbuffer &append_uint(unsigned long long v) {
+        char tmp[24], *p = tmp + sizeof(tmp);
+        do {
+            *--p = static_cast<char>('0' + v % 10);
+        } while (v /= 10);
+        return append(p, tmp + sizeof(tmp) - p);
+    }
+    pbuffer &append_int(long long v) {
+        if (v >= 0)
+            return append_uint(v);
+        append('-');
+        return append_uint(0ull - static_cast<unsigned long long>(v));
+    }
+    // 和printf的"%g"相同（6位有效数字）。先把值缩放为6位整数，缩放只有一次舍入误差，
+    // 只要不在两个整数的正中间附近，舍入的结果就和精确值相同；否则以及指数过大过小时交给snprintf
+    pbuffer &append_float(double v) {
+        static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        char tmp[32];
+        double a = std::fabs(v);
+        if (a == 0)
+            return std::signbit(v) ? append("-0", 2) : append('0');
+        if (!(a >= 1e-16 && a < 1e16))
+            return append(tmp, std::snprintf(tmp, sizeof(tmp), "%g", v));
+        int b2;
+        std::frexp(a, &b2);
+        int e = (b2 - 1) * 30103 / 100000 - (b2 < 1); // floor(log10(a))的估计值，最多相差1
+        double x = 0;
+        for (int k = 0; k < 2; ++k) {
+            x = e <= 5 ? a * pow10[5 - e] : a / pow10[e - 5];
+            if (x < 1e5)
+                --e;
+            else if (x >= 1e6)
+                ++e;
+            else
+                break;
+        }
+        double ip, frac = std::modf(x, &ip);
+        if (x < 1e5 || x >= 1e6 || std::fabs(frac - 0.5) < 1e-6)
+            return append(tmp, std::snprintf(tmp, sizeof(tmp), "%g", v));
+        auto m = static_cast<unsigned long>(ip) + (frac > 0.5);
+        if (m == 1000000)
+            m = 100000, ++e;
+        char digits[6];
+        for (int i = 5; i >= 0; --i, m /= 10)
+            digits[i] = static_cast<char>('0' + m % 10);
+        int nd = 6; // 去掉末尾的0
+        while (nd > 1 && digits[nd - 1] == '0')
+            --nd;
+        char *p = tmp;
+        if (v < 0)
+            *p++ = '-';
+        if (e >= -4 && e < 6) {
+            if (e < 0) {
+                *p++ = '0', *p++ = '.';
+                for (int i = -1; i > e; --i)
+                    *p++ = '0';
+                for (int i = 0; i < nd; ++i)
+                    *p++ = digits[i];
+            } else {
+                for (int i = 0; i <= e; ++i)
+                    *p++ = digits[i];
+                if (nd > e + 1) {
+                    *p++ = '.';
+                    for (int i = e + 1; i < nd; ++i)
+                        *p++ = digits[i];
+                }
+            }
+        } else {
+            *p++ = digits[0];
+            if (nd > 1) {
+                *p++ = '.';
+                for (int i = 1; i < nd; ++i)
+                    *p++ = digits[i];
+            }
+            *p++ = 'e', *p++ = e < 0 ? '-' : '+';
+            int ae = e < 0 ? -e : e;
+            *p++ = static_cast<char>('0' + ae / 10), *p++ = static_cast<char>('0' + ae % 10);
+        }
+        return append(tmp, p - tmp);
+    }
+    pbuffer &append_float(long double v) {
+        char tmp[64];
+        return append(tmp, std::snprintf(tmp, sizeof(tmp), "%Lg", v));
+    }
+    pbuffer &append_pointer(const void *p) {
+        auto v = reinterpret_cast<uintptr_t>(p);
+        char tmp[2 * sizeof(v) + 2], *q = tmp + sizeof(tmp);
+        do {
+            *--q = "0123456789abcdef"[v & 15];
+        } while (v >>= 4);
+        *--q = 'x', *--q = '0';
+        return append(q, tmp + sizeof(tmp) - q);
+    }
+
+    // 将缓冲的内容写入文件，没有给出文件时什么也不做。写入失败时保留未写入的内容
+    void flush() {
+        if (!file)
+            return;
+        size_t w = std::fwrite(buf.data(), 1, buf.size(), file);
+        buf.erase(0, w);
+        if (!buf.empty() || std::fflush(file) != 0)
+            throw std::system_error(errno, std::generic_category(), "pbuffer write failed");
+    }
+};
+
+
+// 运行时统计。定义CRZ_PLIST_STATS后，pcell按类型统计拷贝、堆分配、cast和比较的次数，记录同时存在的
+// 非空pcell的个数及其峰值，并记录sort、map、filter和切片操作的调用次数和耗时；
+// 未定义时统计代码全部为空，不会产生任何开销，stats_snapshot返回空的结果
+
+// 某个类型的统计。cast按目标类型统计，比较按左操作数的类型统计
+struct type_stats {
+    std::string type; // 类型名，和typeid(T).name()相同
+    size_t clones, allocations, casts, bad_casts, comparisons, bad_comparisons;
+};
+
+// 某种列表操作的调用次数和总耗时
+struct op_stats {
+    size_t calls;
+    double ns;
+};
+
+// 用CRZ_STATS_SCOPE标记的代码段中发生的拷贝和堆分配
+struct site_stats {
+    std::string name, file;
+    int line;
+    size_t clones, allocations;
+};
+
+struct plist_stats {
+    bool enabled; // 是否定义了CRZ_PLIST_STATS
+    size_t live_cells, peak_cells;
+    std::vector<type_stats> types;
+    std::vector<site_stats> sites;
+    op_stats sort, map, filter, slice;
+
+    // 输出为便于阅读的表格，只列出有记录的类型和代码段
+    friend std::ostream &operator<<(std::ostream &os, const plist_stats &s) {
+        if (!s.enabled)
+            return os << "plist stats disabled (define CRZ_PLIST_STATS)\n";
+        char line[256];
+        os << "live cells: " << s.live_cells << ", peak: " << s.peak_cells << '\n';
+        std::snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s %10s\n", "type",
+                      "clones", "allocs", "casts", "bad_casts", "compares", "bad_cmps");
+        os << line;
+        for (const auto &t: s.types) {
+            if (!(t.clones || t.allocations || t.casts || t.comparisons || t.bad_comparisons))
+                continue;
+            std::snprintf(line, sizeof(line), "%-24s %10zu %10zu %10zu %10zu %10zu %10zu\n", t.type.c_str(),
+                          t.clones, t.allocations, t.casts, t.bad_casts, t.comparisons, t.bad_comparisons);
+            os << line;
+        }
+        std::snprintf(line, sizeof(line), "%-24s %10s %14s\n", "operation", "calls", "total ms");
+        os << line;
+        const std::pair<const char *, const op_stats *> ops[] = {
+                {"sort",   &s.sort},
+                {"map",    &s.map},
+                {"filter", &s.filter},
+                {"slice",  &s.slice},
+        };
+        for (const auto &op: ops) {
+            std::snprintf(line, sizeof(line), "%-24s %10zu %14.3f\n", op.first, op.second->calls, op.second->ns / 1e6);
+            os << line;
+        }
+        if (!s.sites.empty()) {
+            std::snprintf(line, sizeof(line), "%-24s %10s %10s  %s\n", "scope", "clones", "allocs", "location");
+            os << line;
+            for (const auto &st: s.sites) {
+                std::snprintf(line, sizeof(line), "%-24s %10zu %10zu  %s:%d\n", st.name.c_str(),
+                              st.clones, st.allocations, st.file.c_str(), st.line);
+                os << line;
+            }
+        }
+        return os;
+    }
+};
+
+namespace detail {
+
+#ifdef CRZ_PLIST_STATS
+
+// 每个类型一组计数器，第一次使用时登记到全局的链表中，之后不再释放
+struct __stat_counters {
+    const std::type_info *info;
+    std::atomic<size_t> clones{0}, allocations{0}, casts{0}, bad_casts{0}, comparisons{0}, bad_comparisons{0};
+    __stat_counters *next{nullptr};
+
+    explicit __stat_counters(const std::type_info &t);
+};
+
+// CRZ_STATS_SCOPE标记的代码段，每个位置一个
+struct __stat_site {
+    const char *name, *file;
+    int line;
+    std::atomic<size_t> clones{0}, allocations{0};
+    __stat_site *next{nullptr};
+
+    __stat_site(const char *n, const char *f, int l);
+};
+
+struct __stat_op {
+    std::atomic<size_t> calls{0};
+    std::atomic<uint64_t> ns{0};
 };
 
+enum class __stat_kind { sort, map, filter, slice };
+
+struct __stat_registry {
+    std::mutex lock; // 只在登记新的类型或代码段以及生成快照时使用
+    __stat_counters *types{nullptr};
+    __stat_site *sites{nullptr};
+    std::atomic<size_t> live{0}, peak{0};
+    __stat_op ops[4];
+
+    static __stat_registry &get() {
+        static __stat_registry r;
+        return r;
+    }
+};
+
+inline __stat_counters::__stat_counters(const std::type_info &t) : info(&t) {
+    auto &r = __stat_registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    next = r.types, r.types = this;
+}
+
+inline __stat_site::__stat_site(const char *n, const char *f, int l) : name(n), file(f), line(l) {
+    auto &r = __stat_registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    next = r.sites, r.sites = this;
+}
+
+template<typename T>
+__stat_counters &__stats_of() {
+    static __stat_counters c(typeid(T));
+    return c;
+}
+
+// 当前线程所在的最内层代码段
+inline __stat_site *&__current_site() noexcept {
+    static thread_local __stat_site *site = nullptr;
+    return site;
+}
+
+class __stat_scope {
+    __stat_site *old;
+
+public:
+    explicit __stat_scope(__stat_site &site) noexcept : old(__current_site()) {
+        __current_site() = &site;
+    }
+    __stat_scope(const __stat_scope &) = delete;
+    __stat_scope &operator=(const __stat_scope &) = delete;
+    ~__stat_scope() { __current_site() = old; }
+};
+
+template<typename T>
+inline void __stat_clone() noexcept {
+    __stats_of<T>().clones.fetch_add(1, std::memory_order_relaxed);
+    if (auto s = __current_site())
+        s->clones.fetch_add(1, std::memory_order_relaxed);
+}
+template<typename T>
+inline void __stat_alloc() noexcept {
+    __stats_of<T>().allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto s = __current_site())
+        s->allocations.fetch_add(1, std::memory_order_relaxed);
+}
+template<typename T>
+inline void __stat_cast(bool ok) noexcept {
+    auto &c = __stats_of<T>();
+    c.casts.fetch_add(1, std::memory_order_relaxed);
+    if (!ok)
+        c.bad_casts.fetch_add(1, std::memory_order_relaxed);
+}
+template<typename T>
+inline void __stat_compare() noexcept {
+    __stats_of<T>().comparisons.fetch_add(1, std::memory_order_relaxed);
+}
+template<typename T>
+inline void __stat_bad_compare() noexcept {
+    __stats_of<T>().bad_comparisons.fetch_add(1, std::memory_order_relaxed);
+}
+inline void __stat_cell_created() noexcept {
+    auto &r = __stat_registry::get();
+    size_t n = r.live.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t p = r.peak.load(std::memory_order_relaxed);
+    while (n > p && !r.peak.compare_exchange_weak(p, n, std::memory_order_relaxed)) {}
+}
+inline void __stat_cell_destroyed() noexcept {
+    __stat_registry::get().live.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// 在作用域内计时，离开时计入对应的操作
+class __stat_timer {
+    __stat_op &op;
+    std::chrono::steady_clock::time_point begin;
+
+public:
+    explicit __stat_timer(__stat_kind k) noexcept
+            : op(__stat_registry::get().ops[static_cast<int>(k)]), begin(std::chrono::steady_clock::now()) {}
+    __stat_timer(const __stat_timer &) = delete;
+    __stat_timer &operator=(const __stat_timer &) = delete;
+    ~__stat_timer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+        op.calls.fetch_add(1, std::memory_order_relaxed);
+        op.ns.fetch_add(static_cast<uint64_t>(ns.count()), std::memory_order_relaxed);
+    }
+};
+
+#define __CRZ_STATS_CAT2(a, b) a##b
+#define __CRZ_STATS_CAT(a, b) __CRZ_STATS_CAT2(a, b)
+// 把作用域内发生的拷贝和堆分配记到名为name的代码段上，嵌套时记到最内层
+#define CRZ_STATS_SCOPE(name) \
+    static ::crz::detail::__stat_site __CRZ_STATS_CAT(__crz_stat_site_, __LINE__)(name, __FILE__, __LINE__); \
+    ::crz::detail::__stat_scope __CRZ_STATS_CAT(__crz_stat_scope_, __LINE__)(__CRZ_STATS_CAT(__crz_stat_site_, __LINE__))
+
+#else
+
+enum class __stat_kind { sort, map, filter, slice };
+
+template<typename T>
+inline void __stat_clone() noexcept {}
+template<typename T>
+inline void __stat_alloc() noexcept {}
+template<typename T>
+inline void __stat_cast(bool) noexcept {}
+template<typename T>
+inline void __stat_compare() noexcept {}
+template<typename T>
+inline void __stat_bad_compare() noexcept {}
+inline void __stat_cell_created() noexcept {}
+inline void __stat_cell_destroyed() noexcept {}
+
+struct __stat_timer {
+    explicit __stat_timer(__stat_kind) noexcept {}
+};
+
+#define CRZ_STATS_SCOPE(name) static_cast<void>(0)
+
+#endif
+
+}
+
+// 返回当前的统计结果
+inline plist_stats stats_snapshot() {
+    plist_stats s{};
+#ifdef CRZ_PLIST_STATS
+    auto &r = detail::__stat_registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    s.enabled = true;
+    s.live_cells = r.live.load(std::memory_order_relaxed);
+    s.peak_cells = r.peak.load(std::memory_order_relaxed);
+    for (auto c = r.types; c; c = c->next) {
+        s.types.push_back({c->info->name(), c->clones.load(), c->allocations.load(), c->casts.load(),
+                           c->bad_casts.load(), c->comparisons.load(), c->bad_comparisons.load()});
+    }
+    for (auto st = r.sites; st; st = st->next)
+        s.sites.push_back({st->name, st->file, st->line, st->clones.load(), st->allocations.load()});
+    op_stats *ops[] = {&s.sort, &s.map, &s.filter, &s.slice};
+    for (int k = 0; k < 4; ++k)
+        *ops[k] = {r.ops[k].calls.load(), static_cast<double>(r.ops[k].ns.load())};
+    // 按登记的顺序输出
+    std::reverse(s.types.begin(), s.types.end());
+    std::reverse(s.sites.begin(), s.sites.end());
+#endif
+    return s;
+}
+
+// 清零所有计数。同时存在的pcell个数不清零，峰值重置为当前的个数
+inline void stats_reset() {
+#ifdef CRZ_PLIST_STATS
+    auto &r = detail::__stat_registry::get();
+    std::lock_guard<std::mutex> guard(r.lock);
+    for (auto c = r.types; c; c = c->next) {
+        c->clones = 0, c->allocations = 0, c->casts = 0;
+        c->bad_casts = 0, c->comparisons = 0, c->bad_comparisons = 0;
+    }
+    for (auto st = r.sites; st; st = st->next)
+        st->clones = 0, st->allocations = 0;
+    for (auto &op: r.ops)
+        op.calls = 0, op.ns = 0;
+    r.peak = r.live.load();
+#endif
+}
+
+// 把当前的统计结果输出到os
+inline void stats_dump(std::ostream &os = std::cerr) {
+    os << stats_snapshot();
+}
+
 
 // 实现一些必要的工具
 namespace detail {
@@ -53,6 +522,7 @@ using __void_t = void;
 // 若给定类型未重载<<运算符，则输出给定的字符串
 template<typename T, typename = __void_t<>>
 struct __default_print {
+    static constexpr bool printable = false;
     static std::ostream &print_with_default(std::ostream &os, const T &t, const std::string &s) {
         (void) t;
         return os << s;
@@ -62,18 +532,93 @@ struct __default_print {
 // 若给定类型重载了<<运算符，则输出该类型的对象
 template<typename T>
 struct __default_print<T, __void_t<decltype(std::cout << std::declval<T>())>> {
+    static constexpr bool printable = true;
     static std::ostream &print_with_default(std::ostream &os, const T &t, const std::string &s) {
         (void) s;
         return os << t;
     }
 };
 
+// std::pair按照python中元组的格式输出，例如(1, wow)。用于lazy_list的enumerate和zip
+template<typename A, typename B>
+struct __default_print<std::pair<A, B>> {
+    static constexpr bool printable = true;
+    static std::ostream &print_with_default(std::ostream &os, const std::pair<A, B> &p, const std::string &s) {
+        (void) s;
+        os << '(';
+        __default_print<A>::print_with_default(os, p.first, typeid(A).name());
+        os << ", ";
+        __default_print<B>::print_with_default(os, p.second, typeid(B).name());
+        return os << ')';
+    }
+};
+
+template<typename T>
+using __is_char = std::integral_constant<bool,
+        std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value>;
+
+// 写入pbuffer。常用的类型直接转换，其他可以输出的类型仍经过std::ostream，不能输出的类型写入类型名加上对象的地址
+template<typename T, typename = void>
+struct __buffer_print {
+    static void write(pbuffer &buf, const T &t) {
+        if (__default_print<T>::printable) {
+            std::ostringstream os;
+            __default_print<T>::print_with_default(os, t, std::string());
+            buf.append(os.str());
+        } else {
+            buf.append(typeid(T).name()).append_pointer(&t);
+        }
+    }
+};
+template<typename T>
+struct __buffer_print<T, typename std::enable_if<
+        std::is_integral<T>::value && std::is_signed<T>::value && !__is_char<T>::value>::type> {
+    static void write(pbuffer &buf, const T &t) {
+        buf.append_int(t);
+    }
+};
+template<typename T>
+struct __buffer_print<T, typename std::enable_if<
+        std::is_integral<T>::value && !std::is_signed<T>::value && !__is_char<T>::value>::type> {
+    static void write(pbuffer &buf, const T &t) {
+        buf.append_uint(t);
+    }
+};
+template<typename T>
+struct __buffer_print<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void write(pbuffer &buf, const T &t) {
+        buf.append_float(t);
+    }
+};
+// 和std::ostream一样，字符类型按字符输出
+template<typename T>
+struct __buffer_print<T, typename std::enable_if<__is_char<T>::value>::type> {
+    static void write(pbuffer &buf, const T &t) {
+        buf.append(static_cast<char>(t));
+    }
+};
+template<>
+struct __buffer_print<std::string> {
+    static void write(pbuffer &buf, const std::string &t) {
+        buf.append(t);
+    }
+};
+// 空指针和std::ostream的<<一样不输出任何字符，但不会对空指针调用strlen
+template<>
+struct __buffer_print<const char *> {
+    static void write(pbuffer &buf, const char *t) {
+        if (t)
+            buf.append(t);
+    }
+};
+
 // 利用宏批量生成模板
 // 若给定类型重载了给定的比较运算符，则正常进行比较，否则抛出异常
 #define DEFAULT_COMPARER(opt, name)\
 template<typename T, typename = __void_t<>>\
 struct __default_##name {\
     static bool compare(const T &a, const T &b) {\
+        __stat_bad_compare<T>();\
         throw bad_comparison(typeid(T), typeid(T), #opt);\
     }\
 };\
@@ -92,6 +637,122 @@ DEFAULT_COMPARER(>, greater)
 
 #undef DEFAULT_COMPARER
 
+template<typename T, typename = __void_t<>>
+struct __has_less : std::false_type {};
+template<typename T>
+struct __has_less<T, __void_t<decltype(std::declval<T>() < std::declval<T>())>> : std::true_type {};
+
+template<typename T, typename = __void_t<>>
+struct __has_equal : std::false_type {};
+template<typename T>
+struct __has_equal<T, __void_t<decltype(std::declval<T>() == std::declval<T>())>> : std::true_type {};
+
+// 类型自身提供返回ordering的三路比较成员函数compare时（例如plist），直接使用它
+template<typename T, typename = __void_t<>>
+struct __has_compare : std::false_type {};
+template<typename T>
+struct __has_compare<T, __void_t<decltype(std::declval<const T &>().compare(std::declval<const T &>()))>> :
+        std::is_same<decltype(std::declval<const T &>().compare(std::declval<const T &>())), ordering> {};
+
+// 三路比较，自身不抛出bad_comparison：有compare成员函数时直接调用；有<时用<判断大小，两个方向都不小于时再用==区分相等和无法比较；
+// 只有==时只能判断是否相等；都没有时无法比较
+template<typename T, bool = __has_less<T>::value, bool = __has_equal<T>::value, bool = __has_compare<T>::value>
+struct __default_compare {
+    static ordering compare(const T &a, const T &b) {
+        return a < b ? ordering::less : b < a ? ordering::greater : a == b ? ordering::equal : ordering::incomparable;
+    }
+};
+template<typename T, bool L, bool E>
+struct __default_compare<T, L, E, true> {
+    static ordering compare(const T &a, const T &b) {
+        return a.compare(b);
+    }
+};
+template<typename T>
+struct __default_compare<T, true, false, false> {
+    static ordering compare(const T &a, const T &b) {
+        return a < b ? ordering::less : b < a ? ordering::greater : ordering::equal;
+    }
+};
+template<typename T>
+struct __default_compare<T, false, true, false> {
+    static ordering compare(const T &a, const T &b) {
+        return a == b ? ordering::equal : ordering::incomparable;
+    }
+};
+template<typename T>
+struct __default_compare<T, false, false, false> {
+    static ordering compare(const T &, const T &) {
+        return ordering::incomparable;
+    }
+};
+
+// 若给定类型特化了std::hash，则用其计算哈希值，否则抛出异常
+template<typename T, typename = __void_t<>>
+struct __default_hash {
+    static size_t hash(const T &t) {
+        (void) t;
+        throw bad_pcell_hash(typeid(T));
+    }
+};
+template<typename T>
+struct __default_hash<T, __void_t<decltype(std::hash<T>()(std::declval<const T &>()))>> {
+    static size_t hash(const T &t) {
+        return std::hash<T>()(t);
+    }
+};
+
+// 每个类型唯一的类型标签：类模板静态成员的地址，判断类型是否相同只需一次指针比较
+template<typename T>
+struct __type_tag {
+    static const char id;
+};
+template<typename T>
+const char __type_tag<T>::id = 0;
+
+template<typename T>
+constexpr const void *__tag_of() {
+    return &__type_tag<T>::id;
+}
+
+// 类型列表。__dispatch依次尝试列表中的每个类型，找到与标签匹配的类型T后调用f.template apply<T>()
+template<typename ...Ts>
+struct __type_list {};
+
+template<typename F>
+bool __dispatch(__type_list<>, const void *, F &) {
+    return false;
+}
+template<typename F, typename T, typename ...Ts>
+bool __dispatch(__type_list<T, Ts...>, const void *tag, F &f) {
+    if (tag != __tag_of<T>())
+        return __dispatch(__type_list<Ts...>(), tag, f);
+    f.template apply<T>();
+    return true;
+}
+
+// 保存排序时key函数的返回值。返回左值引用时只保存指针，避免拷贝
+template<typename R, typename = void>
+struct __key_store {
+    using type = typename std::decay<R>::type;
+    static type make(R &&r) {
+        return type(std::forward<R>(r));
+    }
+    static const type &get(const type &k) {
+        return k;
+    }
+};
+template<typename R>
+struct __key_store<R, typename std::enable_if<std::is_lvalue_reference<R>::value>::type> {
+    using type = const typename std::decay<R>::type *;
+    static type make(R r) {
+        return &r;
+    }
+    static const typename std::decay<R>::type &get(type k) {
+        return *k;
+    }
+};
+
 template<typename R, typename ...As>
 struct __function_traits_base {
     using function_type = std::function<R(As...)>;
@@ -124,108 +785,588 @@ struct function_traits
 }
 
 
-// 可以存放不同类型对象的容器。
-class pcell {
+// 内存资源，用于分配pcell中存放在堆上的对象，类似于C++17中的std::pmr::memory_resource。
+// 默认情况下使用全局的new和delete；用resource_scope可以让当前线程中新建的对象改为从给定的资源中分配
+class memory_resource {
+public:
+    virtual ~memory_resource() = default;
+    virtual void *allocate(size_t bytes, size_t align) = 0;
+    virtual void deallocate(void *p, size_t bytes, size_t align) noexcept = 0;
+    // 能否在多个线程中同时使用。只有返回true的资源才会沿用到并行操作的工作线程中
+    virtual bool thread_safe() const noexcept { return false; }
+};
 
-    // 对象持有者的基类，定义了一些虚函数用于运行时的动态操作
-    struct holder {
-        virtual ~holder() noexcept = default;
-        virtual holder *clone() const = 0; // 返回自身的拷贝（持有的对象也进行了拷贝）
-        virtual const std::type_info &type() const noexcept = 0;
-        virtual std::ostream &print(std::ostream &os) const = 0;
-        virtual std::string id() const = 0;
-        virtual bool equal(const holder &h) const = 0;
-        virtual bool less(const holder &h) const = 0;
-        virtual bool greater(const holder &h) const = 0;
-        friend std::ostream &operator<<(std::ostream &os, const holder &h) {
-            return h.print(os);
-        }
+namespace detail {
+
+// 当前线程使用的内存资源，为空表示使用全局的new和delete
+inline memory_resource *&__current_resource() noexcept {
+    static thread_local memory_resource *res = nullptr;
+    return res;
+}
+
+inline size_t __align_up(size_t n, size_t align) noexcept {
+    return (n + align - 1) & ~(align - 1);
+}
+
+}
+
+// 返回当前线程使用的内存资源
+inline memory_resource *current_resource() noexcept {
+    return detail::__current_resource();
+}
+
+// 在作用域内，当前线程中pcell存放在堆上的对象都从给定的资源中分配（包括拷贝产生的对象），
+// 离开作用域后恢复原来的资源。对象记录了自己所属的资源，之后释放时会归还给该资源
+class resource_scope {
+    memory_resource *old;
+
+public:
+    explicit resource_scope(memory_resource *res) noexcept : old(detail::__current_resource()) {
+        detail::__current_resource() = res;
+    }
+    resource_scope(const resource_scope &) = delete;
+    resource_scope &operator=(const resource_scope &) = delete;
+    ~resource_scope() { detail::__current_resource() = old; }
+};
+
+// 单调增长的内存池：分配只需移动指针，释放单个对象不做任何事，release时一次性释放所有内存。
+// 适合生命周期很短的临时列表；从中分配的对象不能比它活得更久。不是线程安全的
+class arena_resource : public memory_resource {
+    struct chunk {
+        chunk *next;
+        size_t size;
     };
 
-    // 真正的对象持有者
-    template<typename T>
-    struct holder_impl : public holder {
-        T val;
+    chunk *head{nullptr};
+    char *cur{nullptr}, *stop{nullptr};
+    size_t next_size;
 
-        holder_impl() = default;
-        template<typename ...Args>
-        explicit holder_impl(Args &&...args):val(std::forward<Args>(args)...) {}
-        holder *clone() const override {
-            return new holder_impl<T>(val);
-        }
-        const std::type_info &type() const noexcept override {
-            return typeid(T);
-        }
-        std::string id() const override {
-            return format(<< type().name() << this);
-        }
-        std::ostream &print(std::ostream &os) const override {
-            return detail::__default_print<T>::print_with_default(os, val, id());
+public:
+    explicit arena_resource(size_t initial_size = 4096) : next_size(initial_size) {}
+    arena_resource(const arena_resource &) = delete;
+    arena_resource &operator=(const arena_resource &) = delete;
+    ~arena_resource() override { release(); }
+
+    void *allocate(size_t bytes, size_t align) override {
+        size_t pos = detail::__align_up(reinterpret_cast<size_t>(cur), align);
+        if (!cur || pos + bytes > reinterpret_cast<size_t>(stop)) {
+            size_t size = std::max(next_size, bytes + align + sizeof(chunk));
+            auto c = static_cast<chunk *>(::operator new(size));
+            c->next = head, c->size = size, head = c;
+            cur = reinterpret_cast<char *>(c + 1), stop = reinterpret_cast<char *>(c) + size;
+            next_size = size * 2;
+            pos = detail::__align_up(reinterpret_cast<size_t>(cur), align);
         }
-        bool equal(const holder &h) const override {
-            return type() == h.type()
-                   ? detail::__default_equal<T>::compare(val,
-                                                         dynamic_cast<const holder_impl <T> &>(h).val)
-                   : false;
+        cur = reinterpret_cast<char *>(pos + bytes);
+        return reinterpret_cast<void *>(pos);
+    }
+    void deallocate(void *, size_t, size_t) noexcept override {}
+
+    // 释放所有内存，之前分配的对象全部失效
+    void release() noexcept {
+        while (head) {
+            chunk *next = head->next;
+            ::operator delete(head);
+            head = next;
         }
-        bool less(const holder &h) const override {
-            if (type() != h.type())
-                throw bad_comparison(type(), h.type(), "<");
-            return detail::__default_less<T>::compare(val,
-                                                      dynamic_cast<const holder_impl <T> &>(h).val);
+        cur = stop = nullptr;
+    }
+};
+
+// 按大小分级的内存池：每个级别维护一个空闲链表，释放的内存块留给同级别的下次分配使用，
+// 过大的请求直接使用全局的new和delete。析构时释放所有内存。不是线程安全的
+class pool_resource : public memory_resource {
+    static constexpr size_t granularity = 16;
+    static constexpr size_t classes = 16; // 最大管理256字节的内存块
+
+    struct node {
+        node *next;
+    };
+
+    node *free_list[classes] = {};
+    arena_resource chunks;
+
+public:
+    pool_resource() = default;
+
+    void *allocate(size_t bytes, size_t align) override {
+        if (bytes > granularity * classes || align > granularity)
+            return ::operator new(bytes);
+        size_t k = (std::max(bytes, size_t(1)) - 1) / granularity;
+        if (node *n = free_list[k]) {
+            free_list[k] = n->next;
+            return n;
         }
-        bool greater(const holder &h) const override {
-            if (type() != h.type())
-                throw bad_comparison(type(), h.type(), ">");
-            return detail::__default_greater<T>::compare(val,
-                                                         dynamic_cast<const holder_impl <T> &>(h).val);
+        return chunks.allocate((k + 1) * granularity, granularity);
+    }
+    void deallocate(void *p, size_t bytes, size_t align) noexcept override {
+        if (bytes > granularity * classes || align > granularity) {
+            ::operator delete(p);
+            return;
         }
-    };
+        size_t k = (std::max(bytes, size_t(1)) - 1) / granularity;
+        auto n = static_cast<node *>(p);
+        n->next = free_list[k], free_list[k] = n;
+    }
+};
 
-    holder *hdr{nullptr};
-    holder *clone() const { return hdr ? hdr->clone() : nullptr; }
 
-    template<typename T>
-    using deref_type = typename std::remove_reference<T>::type;
+namespace detail {
 
-    template<typename T>
-    using decay_type = typename std::decay<T>::type;
+// plist::compact使用的连续内存块：按顺序分配，记录其中存活的对象个数，最后一个对象释放时连同自身一起释放。
+// 因此整理后的对象可以比列表活得更久，也可以被移动到其他列表中。容量不足或对齐要求过高时改用全局的new
+class __compact_block : public memory_resource {
+    char *base, *cur, *stop;
+    std::atomic<size_t> live{1}; // 整理过程中自己持有一个计数
 
-    template<typename T>
-    using base_type = decay_type<deref_type<T>>;
+    explicit __compact_block(size_t bytes)
+            : base(static_cast<char *>(::operator new(bytes))), cur(base), stop(base + bytes) {}
+    ~__compact_block() override { ::operator delete(base); }
+
+    bool owns(void *p) const noexcept {
+        return p >= static_cast<void *>(base) && p < static_cast<void *>(stop);
+    }
 
 public:
-    pcell() = default;
-    // 隐式构造函数，可以进行其他类型到pcell的隐式转换
+    static __compact_block *create(size_t bytes) {
+        return new __compact_block(bytes);
+    }
+
+    void *allocate(size_t bytes, size_t align) override {
+        size_t pos = __align_up(reinterpret_cast<size_t>(cur), align);
+        if (align > alignof(std::max_align_t) || pos + bytes > reinterpret_cast<size_t>(stop))
+            return ::operator new(bytes);
+        cur = reinterpret_cast<char *>(pos + bytes);
+        live.fetch_add(1, std::memory_order_relaxed);
+        return reinterpret_cast<void *>(pos);
+    }
+    void deallocate(void *p, size_t, size_t) noexcept override {
+        if (!owns(p))
+            ::operator delete(p);
+        else
+            release();
+    }
+    // 整理结束时调用，放弃自己持有的计数
+    void release() noexcept {
+        if (live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+};
+
+// 当前线程自动整理的阈值，为0表示不自动整理
+inline size_t &__auto_compact_threshold() noexcept {
+    static thread_local size_t n = 0;
+    return n;
+}
+
+}
+
+// 在作用域内，当前线程中长度不小于min_size的plist在排序重排元素之后自动调用compact，
+// 离开作用域后恢复原来的设置
+class auto_compact_scope {
+    size_t old;
+
+public:
+    explicit auto_compact_scope(size_t min_size = 1) noexcept : old(detail::__auto_compact_threshold()) {
+        detail::__auto_compact_threshold() = std::max<size_t>(min_size, 1);
+    }
+    auto_compact_scope(const auto_compact_scope &) = delete;
+    auto_compact_scope &operator=(const auto_compact_scope &) = delete;
+    ~auto_compact_scope() { detail::__auto_compact_threshold() = old; }
+};
+
+
+// 并行执行策略，传给plist的map、filter、for_each、sort等函数的并行版本。
+// threads为线程数（为0则使用硬件支持的线程数），chunk为每个任务处理的元素个数（为0则自动选择）
+struct par {
+    size_t threads, chunk;
+
+    explicit par(size_t threads = 0, size_t chunk = 0) :
+            threads(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u)), chunk(chunk) {}
+};
+
+// 全序排序的标记，传给plist::sort后可以对混合类型的列表排序，不会抛出bad_comparison
+struct total_order_t {
+    explicit total_order_t() = default;
+};
+constexpr total_order_t total_order{};
+
+namespace detail {
+
+// 将[0, n)划分为若干块，由多个线程执行f(begin, end)。调用者的内存资源是线程安全的时，工作线程沿用该资源；
+// 否则（例如arena_resource、pool_resource）所有线程（包括调用者）在执行f时都使用默认的new和delete，
+// 不会同时从同一个资源中分配。
+// 若有块抛出异常，等所有线程结束后重新抛出编号最小的块的异常，因此结果是确定的
+template<typename F>
+void __parallel_for(size_t n, const par &pol, F f) {
+    if (n == 0)
+        return;
+    size_t chunk = pol.chunk ? pol.chunk : std::max<size_t>((n + pol.threads * 4 - 1) / (pol.threads * 4), 1024);
+    size_t blocks = (n + chunk - 1) / chunk, threads = std::min(pol.threads, blocks);
+    if (threads <= 1) {
+        for (size_t b = 0; b < n; b += chunk)
+            f(b, std::min(b + chunk, n));
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(blocks);
+    memory_resource *res = current_resource();
+    if (res && !res->thread_safe())
+        res = nullptr;
+    auto worker = [&] {
+        resource_scope scope(res);
+        for (size_t b; (b = next++) < blocks;) {
+            try {
+                f(b * chunk, std::min(b * chunk + chunk, n));
+            } catch (...) {
+                errors[b] = std::current_exception();
+            }
+        }
+    };
+    // 创建线程失败时不再创建更多的线程，已经启动的线程和当前线程会完成所有的块，不会因为
+    // 未join的std::thread析构而调用std::terminate
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    try {
+        for (size_t t = 1; t < threads; ++t)
+            pool.emplace_back(worker);
+    } catch (...) {
+    }
+    worker();
+    for (auto &t: pool)
+        t.join();
+    for (auto &e: errors) {
+        if (e)
+            std::rethrow_exception(e);
+    }
+}
+
+// 并行的归并排序：各块分别稳定排序，再逐轮两两归并。归并时相等的元素取前一块的，
+// 因此结果和std::stable_sort完全相同
+template<typename T, typename C>
+void __parallel_stable_sort(std::vector<T> &v, C cmp, const par &pol) {
+    size_t n = v.size();
+    size_t chunk = pol.chunk ? pol.chunk : std::max<size_t>((n + pol.threads - 1) / pol.threads, 1024);
+    if (pol.threads <= 1 || chunk >= n) {
+        std::stable_sort(v.begin(), v.end(), cmp);
+        return;
+    }
+    size_t blocks = (n + chunk - 1) / chunk;
+    __parallel_for(blocks, par(pol.threads, 1), [&](size_t b0, size_t b1) {
+        for (size_t b = b0; b < b1; ++b)
+            std::stable_sort(v.begin() + b * chunk, v.begin() + std::min(b * chunk + chunk, n), cmp);
+    });
+    std::vector<T> buf(n);
+    std::vector<T> *src = &v, *dst = &buf;
+    for (size_t width = chunk; width < n; width *= 2) {
+        size_t pairs = (n + 2 * width - 1) / (2 * width);
+        __parallel_for(pairs, par(pol.threads, 1), [&](size_t p0, size_t p1) {
+            for (size_t p = p0; p < p1; ++p) {
+                size_t lo = p * 2 * width, mid = std::min(lo + width, n), hi = std::min(lo + 2 * width, n);
+                auto s = src->begin();
+                std::merge(std::make_move_iterator(s + lo), std::make_move_iterator(s + mid),
+                           std::make_move_iterator(s + mid), std::make_move_iterator(s + hi),
+                           dst->begin() + lo, cmp);
+            }
+        });
+        std::swap(src, dst);
+    }
+    if (src != &v)
+        v.swap(buf);
+}
+
+}
+
+
+// 原位构造的标记，和C++17中的std::in_place_type_t一样。pcell(in_place_type_t<T>(), args...)直接用args构造T，
+// 不经过临时对象
+template<typename T>
+struct in_place_type_t {
+    explicit in_place_type_t() = default;
+};
+
+// 可以存放不同类型对象的容器。
+class pcell {
+
+    // 对象持有者的操作表，相当于手工实现的虚函数表。每个类型对应一张静态的操作表，
+    // pcell中只保存指向操作表的指针；判断两者类型是否相同只需比较一次类型标签
+    struct holder {
+        const void *tag; // 类型标签
+        const std::type_info *info;
+        void (*clone)(const pcell &src, pcell &dst); // 将src中的对象拷贝到空的dst中
+        void (*move)(pcell &src, pcell &dst) noexcept; // 为空表示可以直接按位移动
+        void (*destroy)(pcell &c) noexcept; // 为空表示无需析构
+        std::ostream &(*print)(std::ostream &os, const pcell &c);
+        void (*write)(pbuffer &buf, const pcell &c); // 写入pbuffer，不经过std::ostream
+        std::string (*id)(const pcell &c);
+        bool (*equal)(const pcell &a, const pcell &b);
+        bool (*less)(const pcell &a, const pcell &b);
+        bool (*greater)(const pcell &a, const pcell &b);
+        ordering (*compare)(const pcell &a, const pcell &b); // 两者类型相同
+        long double (*number)(const pcell &c) noexcept; // 算术类型的值，其他类型为空
+        size_t (*hash)(const pcell &c);
+        void (*relocate)(pcell &c); // 把堆上的对象移动到当前线程的内存资源中重新分配，存放在内部的对象为空
+        size_t heap_size, heap_align; // 从内存资源中分配时内存块的大小和对齐，存放在内部的对象为0
+    };
+
+    // 小对象缓冲区。大小足够放下int、double、指针或短std::string
+    using storage = typename std::aligned_storage<4 * sizeof(void *), alignof(void *)>::type;
+
+    // 只有能放入缓冲区且移动时不会抛出异常的类型才存放在pcell内部，否则存放在堆上
+    template<typename T>
+    using is_local = std::integral_constant<bool,
+            sizeof(T) <= sizeof(storage) &&
+            alignof(T) <= alignof(storage) &&
+            std::is_nothrow_move_constructible<T>::value>;
+
+    // 存放在堆上的对象只需移动指针，存放在内部的可平凡拷贝的对象只需拷贝缓冲区
+    template<typename T>
+    using is_relocatable = std::integral_constant<bool,
+            !is_local<T>::value || std::is_trivially_copyable<T>::value>;
+
+    // 真正的对象持有者，实现了操作表中的各个操作
+    template<typename T>
+    struct holder_impl {
+        static const holder table;
+        static const holder res_table; // 对象从memory_resource中分配时使用的操作表
+
+        // 从memory_resource中分配的内存块的布局：开头记录所属的资源，之后是对象本身
+        static constexpr size_t res_offset = (sizeof(memory_resource *) + alignof(T) - 1) / alignof(T) * alignof(T);
+        static constexpr size_t res_align = alignof(T) > alignof(memory_resource *)
+                                            ? alignof(T) : alignof(memory_resource *);
+        static constexpr size_t res_size = res_offset + sizeof(T);
+
+        static T *get(std::true_type, const pcell &c) noexcept {
+            return reinterpret_cast<T *>(const_cast<storage *>(&c.buf));
+        }
+        static T *get(std::false_type, const pcell &c) noexcept {
+            return static_cast<T *>(c.ptr);
+        }
+        static T *get(const pcell &c) noexcept {
+            return get(is_local<T>(), c);
+        }
+
+        template<typename ...Args>
+        static void create(std::true_type, pcell &c, Args &&...args) {
+            ::new(static_cast<void *>(&c.buf)) T(std::forward<Args>(args)...);
+            c.hdr = &table;
+            detail::__stat_cell_created();
+        }
+        template<typename ...Args>
+        static void create(std::false_type, pcell &c, Args &&...args) {
+            memory_resource *res = current_resource();
+            detail::__stat_alloc<T>();
+            if (!res) {
+                c.ptr = new T(std::forward<Args>(args)...);
+                c.hdr = &table;
+                detail::__stat_cell_created();
+                return;
+            }
+            char *mem = static_cast<char *>(res->allocate(res_size, res_align));
+            try {
+                c.ptr = ::new(static_cast<void *>(mem + res_offset)) T(std::forward<Args>(args)...);
+            } catch (...) {
+                res->deallocate(mem, res_size, res_align);
+                throw;
+            }
+            *reinterpret_cast<memory_resource **>(mem) = res;
+            c.hdr = &res_table;
+            detail::__stat_cell_created();
+        }
+        // 在空的c中构造对象
+        template<typename ...Args>
+        static void create(pcell &c, Args &&...args) {
+            create(is_local<T>(), c, std::forward<Args>(args)...);
+        }
+
+        static void clone(const pcell &src, pcell &dst) {
+            detail::__stat_clone<T>();
+            create(dst, *get(src));
+        }
+        static void move(pcell &src, pcell &dst) noexcept {
+            ::new(static_cast<void *>(&dst.buf)) T(std::move(*get(src)));
+            get(src)->~T();
+            dst.hdr = &table, src.hdr = nullptr;
+        }
+        static void release(std::true_type, pcell &c) noexcept {
+            get(c)->~T();
+        }
+        static void release(std::false_type, pcell &c) noexcept {
+            delete get(c);
+        }
+        static void destroy(pcell &c) noexcept {
+            release(is_local<T>(), c);
+        }
+        static void res_destroy(pcell &c) noexcept {
+            char *mem = static_cast<char *>(c.ptr) - res_offset;
+            get(c)->~T();
+            (*reinterpret_cast<memory_resource **>(mem))->deallocate(mem, res_size, res_align);
+        }
+        static std::string id(const pcell &c) {
+            pbuffer buf;
+            buf.append(typeid(T).name()).append_pointer(get(c));
+            return buf.str();
+        }
+        // 只有不能输出的类型才需要生成id
+        static std::ostream &print(std::ostream &os, const pcell &c) {
+            return detail::__default_print<T>::print_with_default(
+                    os, *get(c), detail::__default_print<T>::printable ? std::string() : id(c));
+        }
+        static void write(pbuffer &buf, const pcell &c) {
+            detail::__buffer_print<T>::write(buf, *get(c));
+        }
+        static bool equal(const pcell &a, const pcell &b) {
+            detail::__stat_compare<T>();
+            return a.hdr->tag == b.hdr->tag
+                   ? detail::__default_equal<T>::compare(*get(a), *get(b))
+                   : false;
+        }
+        static bool less(const pcell &a, const pcell &b) {
+            detail::__stat_compare<T>();
+            if (a.hdr->tag != b.hdr->tag) {
+                detail::__stat_bad_compare<T>();
+                throw bad_comparison(a.type(), b.type(), "<");
+            }
+            return detail::__default_less<T>::compare(*get(a), *get(b));
+        }
+        static bool greater(const pcell &a, const pcell &b) {
+            detail::__stat_compare<T>();
+            if (a.hdr->tag != b.hdr->tag) {
+                detail::__stat_bad_compare<T>();
+                throw bad_comparison(a.type(), b.type(), ">");
+            }
+            return detail::__default_greater<T>::compare(*get(a), *get(b));
+        }
+        static ordering compare(const pcell &a, const pcell &b) {
+            detail::__stat_compare<T>();
+            return detail::__default_compare<T>::compare(*get(a), *get(b));
+        }
+        static long double to_number(std::true_type, const pcell &c) noexcept {
+            return static_cast<long double>(*get(c));
+        }
+        static long double to_number(std::false_type, const pcell &) noexcept {
+            return 0;
+        }
+        static long double number(const pcell &c) noexcept {
+            return to_number(std::is_arithmetic<T>(), c);
+        }
+        static size_t hash(const pcell &c) {
+            return detail::__default_hash<T>::hash(*get(c));
+        }
+        // 先在新的位置构造好对象再释放原来的对象，移动构造抛出异常时c保持不变
+        static void relocate(pcell &c) {
+            pcell tmp;
+            create(tmp, std::move_if_noexcept(*get(c)));
+            c.reset(), c.steal(tmp);
+        }
+    };
+
+    const holder *hdr{nullptr};
+    union {
+        void *ptr;
+        storage buf;
+    };
+
+    // 从rhs处接管对象，要求自身为空
+    void steal(pcell &rhs) noexcept {
+        if (!rhs.hdr)
+            return;
+        if (rhs.hdr->move) {
+            rhs.hdr->move(rhs, *this);
+        } else {
+            std::memcpy(&buf, &rhs.buf, sizeof(buf));
+            hdr = rhs.hdr, rhs.hdr = nullptr;
+        }
+    }
+
+    template<typename T>
+    using deref_type = typename std::remove_reference<T>::type;
+
+    template<typename T>
+    using decay_type = typename std::decay<T>::type;
+
+    template<typename T>
+    using base_type = decay_type<deref_type<T>>;
+
+    template<typename T>
+    struct is_in_place : std::false_type {};
+    template<typename T>
+    struct is_in_place<in_place_type_t<T>> : std::true_type {};
+
+public:
+    pcell() = default;
+    // 隐式构造函数，可以进行其他类型到pcell的隐式转换
+    template<typename T, typename B = base_type<T>,
+            typename = typename std::enable_if<!std::is_same<B, pcell>::value && !is_in_place<B>::value>::type>
+    pcell(T &&t) { holder_impl<B>::create(*this, std::forward<T>(t)); }
+    // 原位构造，直接在最终的位置（内部缓冲区或堆上）用args构造T的对象
+    template<typename T, typename ...Args>
+    explicit pcell(in_place_type_t<T>, Args &&...args) {
+        static_assert(std::is_same<T, base_type<T>>::value && !std::is_same<T, pcell>::value,
+                      "pcell can only hold non-reference object types other than pcell");
+        holder_impl<T>::create(*this, std::forward<Args>(args)...);
+    }
+    // 存放在堆上的对象从给定的内存资源中分配
     template<typename T, typename B = base_type<T>,
             typename = typename std::enable_if<!std::is_same<B, pcell>::value>::type>
-    pcell(T &&t) : hdr(new holder_impl<B>(std::forward<T>(t))) {}
-    // 拷贝构造函数，调用clone函数来动态地拷贝值
-    pcell(const pcell &rhs) : hdr(rhs.clone()) {}
-    // 移动构造函数，直接交换指针
-    pcell(pcell &&rhs) noexcept : hdr(rhs.hdr) { rhs.hdr = nullptr; }
+    pcell(std::allocator_arg_t, memory_resource *res, T &&t) {
+        resource_scope scope(res);
+        holder_impl<B>::create(*this, std::forward<T>(t));
+    }
+    // 拷贝构造函数，调用操作表中的clone函数来动态地拷贝值
+    pcell(const pcell &rhs) {
+        if (rhs.hdr)
+            rhs.hdr->clone(rhs, *this);
+    }
+    // 移动构造函数，堆上的对象直接移动指针，缓冲区中的对象则移动过来
+    pcell(pcell &&rhs) noexcept { steal(rhs); }
 
     ~pcell() { reset(); }
 
-    // 拷贝运算符。rhs构造时会根据情况调用拷贝构造和或移动构造，因此只要实现一个拷贝运算即可。
-    pcell &operator=(pcell rhs) {
-        swap(rhs);
+    // 拷贝运算符，先拷贝再交换
+    pcell &operator=(const pcell &rhs) {
+        pcell tmp(rhs);
+        swap(tmp);
+        return *this;
+    }
+    // 移动运算符，直接接管rhs中的对象。排序、重排等操作中的大量移动都经过这里
+    pcell &operator=(pcell &&rhs) noexcept {
+        if (this != &rhs)
+            reset(), steal(rhs);
         return *this;
     }
     template<typename T, typename B = base_type<T>,
             typename = typename std::enable_if<!std::is_same<B, pcell>::value>::type>
     pcell &operator=(T &&t) {
-        reset(), hdr = new holder_impl<B>(std::forward<T>(t));
+        reset(), holder_impl<B>::create(*this, std::forward<T>(t));
         return *this;
     }
 
+    // 销毁原有的对象，再用args原位构造T的对象，返回其引用。构造时抛出异常则容器为空
+    template<typename T, typename ...Args>
+    T &emplace(Args &&...args) {
+        static_assert(std::is_same<T, base_type<T>>::value && !std::is_same<T, pcell>::value,
+                      "pcell can only hold non-reference object types other than pcell");
+        reset();
+        holder_impl<T>::create(*this, std::forward<Args>(args)...);
+        return *holder_impl<T>::get(*this);
+    }
+
     // 清除容器
     void reset() noexcept {
-        if (hdr)
-            delete (hdr), hdr = nullptr;
+        if (!hdr)
+            return;
+        detail::__stat_cell_destroyed();
+        if (hdr->destroy)
+            hdr->destroy(*this);
+        hdr = nullptr;
     }
     void swap(pcell &rhs) noexcept {
-        std::swap(hdr, rhs.hdr);
+        if (this == &rhs)
+            return;
+        pcell tmp(std::move(rhs));
+        rhs.steal(*this);
+        steal(tmp);
     }
     // 判断容器内是否包含着对象
     bool has_value() const noexcept {
@@ -233,10 +1374,14 @@ public:
     }
     // 返回容器包含对象的类型的type_info
     const std::type_info &type() const noexcept {
-        return has_value() ? hdr->type() : typeid(void);
+        return has_value() ? *hdr->info : typeid(void);
     }
     std::string id() const {
-        return has_value() ? hdr->id() : std::string("None");
+        return has_value() ? hdr->id(*this) : std::string("None");
+    }
+    // 返回容器内对象的哈希值，空容器的哈希值为0。对象的类型没有特化std::hash时抛出异常
+    size_t hash() const {
+        return has_value() ? hdr->hash(*this) : 0;
     }
     // 返回容器内的对象的值
     // 目标的底层类型不为pcell
@@ -245,7 +1390,7 @@ public:
                     !std::is_same<B, pcell>::value
             >::type>
     T cast() {
-        return get_holder_impl<T>()->val;
+        return *get_value<T>();
     }
     // 目标的底层类型不为pcell且目标不为非常量引用
     template<typename T, typename B = base_type<T>, typename = void,
@@ -255,7 +1400,7 @@ public:
                      std::is_const<deref_type<T>>::value)
             >::type>
     T cast() const {
-        return get_holder_impl<T>()->val;
+        return *get_value<T>();
     }
     // 目标的底层类型为pcell
     template<typename T, typename B = base_type<T>,
@@ -275,10 +1420,34 @@ public:
     T cast() const {
         return *this;
     }
-    // 判断容器内的对象是否为给定类型（其实可以直接用type_info判断）
+    // 判断容器内的对象是否为给定类型，只需比较类型标签
     template<typename T, typename B = base_type<T>>
     bool isa() const {
-        return !has_value() ? false : dynamic_cast<holder_impl <B> *>(hdr) != nullptr;
+        return has_value() && hdr->tag == detail::__tag_of<B>();
+    }
+    // 对象的类型为T时返回指向它的指针，否则（包括容器为空）返回空指针，不抛出异常。
+    // 代替先isa<T>()再cast<T>()的写法，只需比较一次类型标签
+    template<typename T, typename B = base_type<T>>
+    B *try_cast() noexcept {
+        return isa<B>() ? holder_impl<B>::get(*this) : nullptr;
+    }
+    template<typename T, typename B = base_type<T>>
+    const B *try_cast() const noexcept {
+        return isa<B>() ? holder_impl<B>::get(*this) : nullptr;
+    }
+    // 三路比较，不抛出bad_comparison。类型相同时按该类型的<和==比较；两者都是算术类型时按数值比较（和python一样1 < 2.5）；
+    // 其他情况（类型不同、其中一方为空、类型不支持比较、NaN等）返回ordering::incomparable。两者都为空时视作相等。
+    // 嵌套的plist按字典序逐个比较元素。类型自身的<和==抛出的异常原样传出
+    ordering compare(const pcell &rhs) const {
+        if (!has_value() || !rhs.has_value())
+            return has_value() == rhs.has_value() ? ordering::equal : ordering::incomparable;
+        if (hdr->tag == rhs.hdr->tag)
+            return hdr->compare(*this, rhs);
+        if (hdr->number && rhs.hdr->number) {
+            long double a = hdr->number(*this), b = rhs.hdr->number(rhs);
+            return a < b ? ordering::less : b < a ? ordering::greater : a == b ? ordering::equal : ordering::incomparable;
+        }
+        return ordering::incomparable;
     }
     // 显式类型转换函数
     template<typename T>
@@ -286,15 +1455,20 @@ public:
         return cast<T>();
     }
 
+    // 将对象的输出写入buf，格式和<<相同
+    void write_to(pbuffer &buf) const {
+        has_value() ? hdr->write(buf, *this) : void(buf.append("None", 4));
+    }
+
     // 重载<<运算；如果容器内为空，则输出"None"
     friend std::ostream &operator<<(std::ostream &os, const pcell &cell) {
-        return cell.has_value() ? (os << *cell.hdr) : (os << "None");
+        return cell.has_value() ? cell.hdr->print(os, cell) : (os << "None");
     }
     // 重载==和!=；当前仅当两者都为空或都含有相同的值视作相等，其他情况视作不相等（并不会抛出异常）
     // 不过，如果两者类型相同，但其类型没有重载==，则会抛出异常
     friend bool operator==(const pcell &a, const pcell &b) {
         if (a.has_value() && b.has_value())
-            return a.hdr->equal(*b.hdr);
+            return a.hdr->equal(a, b);
         return a.has_value() == b.has_value();
     }
     friend bool operator!=(const pcell &a, const pcell &b) {
@@ -304,12 +1478,12 @@ public:
     // 两者类型相同但没有重载相应运算符，也会抛出异常
     friend bool operator<(const pcell &a, const pcell &b) {
         if (a.has_value() && b.has_value())
-            return a.hdr->less(*b.hdr);
+            return a.hdr->less(a, b);
         throw bad_comparison(a.type(), b.type(), "<");
     }
     friend bool operator>(const pcell &a, const pcell &b) {
         if (a.has_value() && b.has_value())
-            return a.hdr->greater(*b.hdr);
+            return a.hdr->greater(a, b);
         throw bad_comparison(a.type(), b.type(), ">");
     }
     friend bool operator<=(const pcell &a, const pcell &b) {
@@ -320,176 +1494,925 @@ public:
     }
 
 private:
+    friend class plist;
+
+    // 返回类型标签，空容器返回空指针
+    const void *tag() const noexcept {
+        return hdr ? hdr->tag : nullptr;
+    }
+    // 不做任何检查直接取出对象，调用者需保证容器内对象的类型为T
+    template<typename T>
+    T &get_unchecked() const noexcept {
+        return *holder_impl<T>::get(*this);
+    }
+    // 类型标签匹配后直接进行静态转换
     template<typename T, typename B = base_type<T>>
-    holder_impl<B> *get_holder_impl() const {
-        if (!has_value())
+    B *get_value() const {
+        if (!has_value()) {
+            detail::__stat_cast<B>(false);
             throw bad_pcell_access();
-        auto hdr_impl = dynamic_cast<holder_impl <B> *>(hdr);
-        if (!hdr_impl)
+        }
+        if (hdr->tag != detail::__tag_of<B>()) {
+            detail::__stat_cast<B>(false);
             throw bad_pcell_cast(type(), typeid(T));
-        return hdr_impl;
+        }
+        detail::__stat_cast<B>(true);
+        return holder_impl<B>::get(*this);
     }
 };
 
+template<typename T>
+const pcell::holder pcell::holder_impl<T>::table = {
+        detail::__tag_of<T>(),
+        &typeid(T),
+        &holder_impl<T>::clone,
+        is_relocatable<T>::value ? nullptr : &holder_impl<T>::move,
+        is_local<T>::value && std::is_trivially_destructible<T>::value ? nullptr : &holder_impl<T>::destroy,
+        &holder_impl<T>::print,
+        &holder_impl<T>::write,
+        &holder_impl<T>::id,
+        &holder_impl<T>::equal,
+        &holder_impl<T>::less,
+        &holder_impl<T>::greater,
+        &holder_impl<T>::compare,
+        std::is_arithmetic<T>::value ? &holder_impl<T>::number : nullptr,
+        &holder_impl<T>::hash,
+        is_local<T>::value ? nullptr : &holder_impl<T>::relocate,
+        is_local<T>::value ? 0 : size_t(holder_impl<T>::res_size),
+        is_local<T>::value ? 0 : size_t(holder_impl<T>::res_align),
+};
 
-// python-like list，继承自vector以复用其大部分的函数
-class plist : public std::vector<pcell> {
-    // 类似于python中的slice类型
-    class maybe_int {
-        int val{0};
-        bool has_val{false};
+template<typename T>
+const pcell::holder pcell::holder_impl<T>::res_table = {
+        detail::__tag_of<T>(),
+        &typeid(T),
+        &holder_impl<T>::clone,
+        nullptr,
+        &holder_impl<T>::res_destroy,
+        &holder_impl<T>::print,
+        &holder_impl<T>::write,
+        &holder_impl<T>::id,
+        &holder_impl<T>::equal,
+        &holder_impl<T>::less,
+        &holder_impl<T>::greater,
+        &holder_impl<T>::compare,
+        std::is_arithmetic<T>::value ? &holder_impl<T>::number : nullptr,
+        &holder_impl<T>::hash,
+        &holder_impl<T>::relocate,
+        size_t(holder_impl<T>::res_size),
+        size_t(holder_impl<T>::res_align),
+};
 
-    public:
-        maybe_int(int v) : val(v), has_val(true) {}
-        maybe_int() = default;
-        bool has_value() const { return has_val; }
-        operator int() const { return val; }
-    };
 
-    class pslice {
-        maybe_int start_{}, stop_{};
-        int step_{1};
+namespace detail {
 
-    public:
-        pslice(maybe_int b, maybe_int e, int s = 1) : start_(b), stop_(e), step_(s) {
-            if (s == 0)
-                throw std::logic_error("slice step must be non-zero");
-        }
+// 以指针保存pcell的哈希表，按指向的值求哈希和判断相等，不拷贝元素
+struct __cell_ref_hash {
+    size_t operator()(const pcell *c) const {
+        return c->hash();
+    }
+};
+struct __cell_ref_equal {
+    bool operator()(const pcell *a, const pcell *b) const {
+        return *a == *b;
+    }
+};
+using __cell_set = std::unordered_set<const pcell *, __cell_ref_hash, __cell_ref_equal>;
 
-        maybe_int start() const { return start_; }
-        maybe_int stop() const { return stop_; }
-        int step() const { return step_; }
-    };
+// 每个线程一个反复使用的输出缓冲区。嵌套使用时（例如用户类型的<<中又输出了列表）改用临时的缓冲区
+class __buffer_lease {
+    pbuffer local;
+    pbuffer *buf;
 
-    int index_trans(int i) const {
-        if (i < 0)
-            i += size();
-        if (i < 0)
-            throw std::out_of_range("index out of range");
-        return i;
+    static pbuffer &shared() {
+        static thread_local pbuffer b;
+        return b;
+    }
+    static bool &busy() {
+        static thread_local bool b = false;
+        return b;
     }
 
-    template<typename F>
-    using first_arg_type = typename ft::function_traits<F>::template argument_type<0>;
+public:
+    __buffer_lease() : buf(busy() ? &local : &shared()) {
+        if (buf != &local)
+            busy() = true;
+        buf->clear();
+    }
+    __buffer_lease(const __buffer_lease &) = delete;
+    __buffer_lease &operator=(const __buffer_lease &) = delete;
+    ~__buffer_lease() {
+        if (buf != &local)
+            busy() = false;
+    }
+    pbuffer &get() noexcept { return *buf; }
+};
+
+// 输出流是否为默认的格式。只有默认格式时列表才经过pbuffer输出，否则仍逐个元素经过std::ostream，以遵从流的设置
+inline bool __default_format(const std::ostream &os) {
+    return os.flags() == (std::ios_base::skipws | std::ios_base::dec) && os.precision() == 6 && os.width() == 0;
+}
+
+// 把支持负数的下标i转换为长度为len的序列中的位置，越界（包括正数越界）时抛出std::out_of_range。
+// 负数先取绝对值再和len比较，i为PTRDIFF_MIN时也不会溢出
+inline size_t __index_trans(std::ptrdiff_t i, size_t len) {
+    size_t k = i < 0 ? static_cast<size_t>(-(i + 1)) + 1 : static_cast<size_t>(i);
+    if (i < 0 ? k > len : k >= len)
+        throw std::out_of_range("index out of range");
+    return i < 0 ? len - k : k;
+}
+// 和python的l.insert(i, x)一样：支持负数索引，越界时截断到开头或末尾
+inline size_t __insert_pos(std::ptrdiff_t i, size_t len) {
+    if (i >= 0)
+        return std::min(static_cast<size_t>(i), len);
+    size_t k = static_cast<size_t>(-(i + 1)) + 1;
+    return k > len ? 0 : len - k;
+}
+
+}
+
+
+// 类似于python中的slice类型
+// 切片的起点和终点，可以省略。下标都用std::ptrdiff_t表示，列表的长度可以超过2^31
+class maybe_int {
+    std::ptrdiff_t val{0};
+    bool has_val{false};
 
 public:
-    using std::vector<pcell>::vector;
+    maybe_int(std::ptrdiff_t v) : val(v), has_val(true) {}
+    maybe_int() = default;
+    bool has_value() const { return has_val; }
+    operator std::ptrdiff_t() const { return val; }
+};
 
-    // 直接索引访问，支持负数索引。返回对应pcell的引用
-    pcell &operator[](int i) {
-        return std::vector<pcell>::operator[](index_trans(i));
-    }
-    const pcell &operator[](int i) const {
-        return std::vector<pcell>::operator[](index_trans(i));
+class pslice {
+    maybe_int start_{}, stop_{};
+    std::ptrdiff_t step_{1};
+
+public:
+    pslice(maybe_int b, maybe_int e, std::ptrdiff_t s = 1) : start_(b), stop_(e), step_(s) {
+        if (s == 0)
+            throw std::logic_error("slice step must be non-zero");
     }
-    // 切片索引访问，返回一个新的plist
-    plist operator[](pslice sl) const {
-        plist res;
-        int step = sl.step(), len = size();
-        if (!sl.start().has_value() && !sl.stop().has_value()) {
-            if (step > 0) {
-                for (int i = 0; i < len; i += step)
-                    res.push_back(std::vector<pcell>::operator[](i));
-            } else {
-                for (int i = len - 1; i >= 0; i += step)
-                    res.push_back(std::vector<pcell>::operator[](i));
-            }
+
+    maybe_int start() const { return start_; }
+    maybe_int stop() const { return stop_; }
+    std::ptrdiff_t step() const { return step_; }
+
+    // 和python中的slice.indices一样，对长度为len的列表计算实际的起点，并返回切片的准确长度。
+    // 负数索引加上len，越界的起点和终点截断到列表范围内。各步都不会溢出，步长为PTRDIFF_MIN时同样正确
+    std::ptrdiff_t indices(std::ptrdiff_t len, std::ptrdiff_t &start) const {
+        std::ptrdiff_t stop;
+        if (step_ > 0) {
+            start = clamp(start_, 0, 0, len, len);
+            stop = clamp(stop_, len, 0, len, len);
+            return start < stop ? (stop - start - 1) / step_ + 1 : 0;
         } else {
-            int start = sl.start().has_value() ? index_trans(sl.start()) : 0;
-            int stop = sl.stop().has_value() ? index_trans(sl.stop()) : len;
-            if (step > 0 && start <= stop) {
-                for (int i = start; i < stop; i += step)
-                    res.push_back(std::vector<pcell>::operator[](i));
-            } else if (step < 0 && start >= stop) {
-                for (int i = start; i > stop; i += step)
-                    res.push_back(std::vector<pcell>::operator[](i));
-            }
+            start = clamp(start_, len - 1, -1, len - 1, len);
+            stop = clamp(stop_, -1, -1, len - 1, len);
+            return start > stop ? 1 - (start - stop - 1) / step_ : 0;
         }
-        return res;
     }
 
-    // 列表连接
-    friend plist operator+(const plist &a, const plist &b) {
-        auto res = a;
-        return res += b;
+private:
+    static std::ptrdiff_t clamp(maybe_int i, std::ptrdiff_t dft, std::ptrdiff_t lo, std::ptrdiff_t hi,
+                                std::ptrdiff_t len) {
+        if (!i.has_value())
+            return dft;
+        std::ptrdiff_t v = i;
+        if (v < 0)
+            v = v < lo - len ? lo : v + len;
+        return v < lo ? lo : v > hi ? hi : v;
     }
-    plist &operator+=(const plist &pl) {
-        size_t len = pl.size();
-        for (size_t i = 0; i < len; ++i)
-            push_back(pl[i]);
-        return *this;
+};
+
+class plist;
+
+// 列表切片的视图，保存所属列表以及切片的起点、步长和长度，不拷贝任何元素。
+// 可以遍历、索引、输出，也可以通过视图修改列表中的元素；需要时再显式地转换为plist。
+// 视图不延长列表的生命周期；列表的长度改变后，之前的视图不再有效
+template<typename L>
+class basic_plist_view {
+    using list_type = typename std::remove_const<L>::type;
+    using cell_type = typename std::conditional<std::is_const<L>::value, const pcell, pcell>::type;
+
+    L *lst;
+    std::ptrdiff_t start_, step_, len_;
+
+    // 再切片后的步长。长度超过1时两个步长之积不超过列表的长度；否则步长只用于区分切片赋值时是否为1，
+    // 不直接相乘，避免溢出
+    static std::ptrdiff_t step_product(std::ptrdiff_t a, std::ptrdiff_t b, std::ptrdiff_t len) {
+        if (len > 1)
+            return a * b;
+        return (a == 1 || a == -1) && a == b ? 1 : 2;
     }
-    // 列表拷贝
-    friend plist operator*(size_t time, const plist &pl) {
-        return pl * time;
+
+    static std::ptrdiff_t clamp_start(std::ptrdiff_t start, size_t size) {
+        return start < 0 ? 0 : start > std::ptrdiff_t(size) ? std::ptrdiff_t(size) : start;
     }
-    friend plist operator*(const plist &pl, size_t time) {
-        auto res = pl;
-        return res *= time;
+
+public:
+    // 按步长访问列表元素的随机访问迭代器。记录的是在视图中的序号而不是在列表中的位置，
+    // 尾后迭代器不需要计算可能越过列表范围（甚至溢出）的位置
+    class iterator {
+        cell_type *first;
+        std::ptrdiff_t idx, step;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = pcell;
+        using difference_type = std::ptrdiff_t;
+        using pointer = cell_type *;
+        using reference = cell_type &;
+
+        iterator(cell_type *f, std::ptrdiff_t i, std::ptrdiff_t s) : first(f), idx(i), step(s) {}
+        cell_type &operator*() const { return first[idx * step]; }
+        cell_type *operator->() const { return first + idx * step; }
+        cell_type &operator[](difference_type n) const { return first[(idx + n) * step]; }
+        iterator &operator++() { return ++idx, *this; }
+        iterator &operator--() { return --idx, *this; }
+        iterator operator++(int) { auto it = *this; return ++idx, it; }
+        iterator operator--(int) { auto it = *this; return --idx, it; }
+        iterator &operator+=(difference_type n) { return idx += n, *this; }
+        iterator &operator-=(difference_type n) { return idx -= n, *this; }
+        friend iterator operator+(iterator it, difference_type n) { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const iterator &a, const iterator &b) { return a.idx - b.idx; }
+        friend bool operator==(const iterator &a, const iterator &b) { return a.idx == b.idx; }
+        friend bool operator!=(const iterator &a, const iterator &b) { return a.idx != b.idx; }
+        friend bool operator<(const iterator &a, const iterator &b) { return a.idx < b.idx; }
+        friend bool operator>(const iterator &a, const iterator &b) { return b < a; }
+        friend bool operator<=(const iterator &a, const iterator &b) { return !(b < a); }
+        friend bool operator>=(const iterator &a, const iterator &b) { return !(a < b); }
+    };
+
+    // 空的切片的起点可能在列表之外（例如步长为负时为-1），截断到[0, size]内，
+    // 使begin、end不会算出列表范围之外的地址。非空切片的起点总在列表内
+    basic_plist_view(L &l, std::ptrdiff_t start, std::ptrdiff_t step, std::ptrdiff_t len) :
+            lst(&l), start_(len ? start : clamp_start(start, l.size())), step_(step), len_(len) {}
+    // 非常量视图可以转换为常量视图
+    template<typename M, typename = typename std::enable_if<
+            std::is_same<const M, L>::value && !std::is_same<M, L>::value>::type>
+    basic_plist_view(const basic_plist_view<M> &v) : lst(&v.list()), start_(v.start()), step_(v.step()),
+                                                     len_(v.size()) {}
+
+    L &list() const { return *lst; }
+    std::ptrdiff_t start() const { return start_; }
+    std::ptrdiff_t step() const { return step_; }
+    size_t size() const { return len_; }
+    bool empty() const { return len_ == 0; }
+
+    iterator begin() const { return iterator(lst->data() + start_, 0, step_); }
+    iterator end() const { return iterator(lst->data() + start_, len_, step_); }
+    cell_type &front() const { return lst->data()[start_]; }
+    cell_type &back() const { return lst->data()[start_ + (len_ - 1) * step_]; }
+
+    // 直接索引访问，支持负数索引
+    cell_type &operator[](std::ptrdiff_t i) const {
+        return lst->data()[start_ + static_cast<std::ptrdiff_t>(detail::__index_trans(i, len_)) * step_];
     }
-    plist &operator*=(size_t time) {
-        size_t old_len = size();
-        for (size_t t = 1; t < time; ++t) {
-            for (size_t i = 0; i < old_len; ++i) {
-                push_back((*this)[i]);
-            }
-        }
+    // 对视图再切片，得到的仍是原列表的视图。结果为空时起点可能是-1，不和步长相乘，避免溢出
+    basic_plist_view operator[](pslice sl) const {
+        std::ptrdiff_t start, len = sl.indices(len_, start);
+        return basic_plist_view(*lst, len ? start_ + start * step_ : start_, step_product(step_, sl.step(), len), len);
+    }
+
+    // 切片赋值，和python的l[a:b:c] = src一样。步长为1时src的长度可以和切片不同，
+    // 列表的长度随之改变；步长不为1时两者长度必须相同。src按值传入，因此可以是列表自身
+    basic_plist_view &operator=(list_type src) {
+        lst->assign_slice(start_, step_, len_, std::move(src));
+        if (step_ == 1)
+            len_ = static_cast<std::ptrdiff_t>(src.size());
         return *this;
     }
-    // 列表输出
-    friend std::ostream &operator<<(std::ostream &os, const plist &pl) {
-        if (pl.empty())
+    basic_plist_view &operator=(std::initializer_list<pcell> src) {
+        return *this = list_type(src);
+    }
+    basic_plist_view &operator=(const basic_plist_view &v) {
+        return *this = v.to_plist();
+    }
+    template<typename M>
+    basic_plist_view &operator=(const basic_plist_view<M> &v) {
+        return *this = v.to_plist();
+    }
+
+    // 将视图中的元素拷贝为新的plist
+    list_type to_plist() const {
+        detail::__stat_timer timer(detail::__stat_kind::slice);
+        list_type res;
+        res.reserve(len_);
+        for (const auto &x: *this)
+            res.push_back(x);
+        return res;
+    }
+    operator list_type() const {
+        return to_plist();
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const basic_plist_view &v) {
+        if (v.empty())
             return os << "[]";
         os << '[';
-        auto it = pl.begin(), stop = pl.end();
+        auto it = v.begin(), stop = v.end();
         os << *it++;
         for (; it != stop; ++it)
             os << ", " << *it;
         os << ']';
         return os;
     }
-    // 列表转换为字符串
-    explicit operator std::string() const {
-        return format(<< *this);
-    }
+};
 
-    // python API
-    size_t count(const pcell &pc) const {
-        return std::count(begin(), end(), pc);
-    }
-    int index(const pcell &pc) const {
-        auto it = std::find(begin(), end(), pc);
-        return it == end() ? -1 : static_cast<int>(it - begin());
+using plist_view = basic_plist_view<plist>;
+using const_plist_view = basic_plist_view<const plist>;
+
+template<typename Src>
+class lazy_list;
+
+class plist_index;
+
+namespace detail {
+struct __lazy_source;
+}
+
+
+// python-like list，继承自vector以复用其大部分的函数
+class plist : public std::vector<pcell> {
+    size_t index_trans(std::ptrdiff_t i) const {
+        return detail::__index_trans(i, size());
     }
-    void append(const pcell &pc) {
-        push_back(pc);
+    // python中insert的位置：负数从末尾算起，越界时截断到[0, size()]
+    size_t insert_pos(std::ptrdiff_t i) const {
+        return detail::__insert_pos(i, size());
     }
-    void extend(const plist &pl) {
-        *this += pl;
+
+    template<typename F>
+    using first_arg_type = typename ft::function_traits<F>::template argument_type<0>;
+
+    // 这些类型的元素在排序和查找时走类型特化的快速路径，不经过操作表
+    using fast_types = detail::__type_list<
+            char, signed char, unsigned char, short, unsigned short, int, unsigned int,
+            long, unsigned long, long long, unsigned long long, float, double, std::string>;
+    // 其中值之间总能比较的类型（没有NaN），全序排序时可以直接使用快速路径
+    using ordered_types = detail::__type_list<
+            char, signed char, unsigned char, short, unsigned short, int, unsigned int,
+            long, unsigned long, long long, unsigned long long, std::string>;
+
+    std::vector<pcell> &base() noexcept {
+        return *this;
     }
-    void remove(const pcell &pc) {
-        erase(std::remove(begin(), end(), pc), end());
+    const std::vector<pcell> &base() const noexcept {
+        return *this;
     }
-    void reverse() {
+
+    // 原地重排元素：重排后第i个位置放置原来的第order[i]个元素。会修改order
+    void permute(std::vector<size_t> &order) {
+        auto &v = base();
+        for (size_t i = 0, len = order.size(); i < len; ++i) {
+            if (order[i] == i)
+                continue;
+            pcell tmp(std::move(v[i]));
+            size_t j = i;
+            while (order[j] != i) {
+                size_t next = order[j];
+                v[j] = std::move(v[next]);
+                order[j] = j, j = next;
+            }
+            v[j] = std::move(tmp);
+            order[j] = j;
+        }
+        size_t threshold = detail::__auto_compact_threshold();
+        if (threshold && size() >= threshold)
+            compact();
+    }
+
+    // 整理时需要重新分配的对象：存放在堆上且对齐要求不超过max_align_t
+    static bool movable_to_block(const pcell &c) noexcept {
+        return c.hdr && c.hdr->relocate && c.hdr->heap_align <= alignof(std::max_align_t);
+    }
+    // 按整理时的顺序（嵌套的列表深度优先）累计需要的内存
+    static void compact_size(const plist &pl, size_t &bytes) {
+        for (const auto &x: pl) {
+            if (movable_to_block(x))
+                bytes = detail::__align_up(bytes, x.hdr->heap_align) + x.hdr->heap_size;
+            else if (x.isa<plist>())
+                compact_size(x.get_unchecked<plist>(), bytes);
+        }
+    }
+    static void compact_into(plist &pl) {
+        for (auto &x: pl) {
+            if (movable_to_block(x))
+                x.hdr->relocate(x);
+            else if (x.isa<plist>())
+                compact_into(x.get_unchecked<plist>());
+        }
+    }
+
+    template<typename>
+    friend class basic_plist_view;
+
+    // 为增长到n个元素预留空间。一次性的增长直接分配到n，反复增长时仍保持几何级数的扩容
+    void grow(size_t n) {
+        if (n > capacity())
+            reserve(std::max(n, 2 * capacity()));
+    }
+
+    // 用src替换起点为start、步长为step、长度为len的切片，src中的元素直接移动进来
+    void assign_slice(std::ptrdiff_t start, std::ptrdiff_t step, std::ptrdiff_t len, plist &&src) {
+        detail::__stat_timer timer(detail::__stat_kind::slice);
+        auto &v = base();
+        auto m = static_cast<std::ptrdiff_t>(src.size());
+        if (step != 1) {
+            if (m != len)
+                throw std::invalid_argument("attempt to assign sequence of size " + std::to_string(m) +
+                                            " to extended slice of size " + std::to_string(len));
+            for (std::ptrdiff_t i = 0; i < len; ++i)
+                v[start + i * step] = std::move(src.base()[i]);
+            return;
+        }
+        std::ptrdiff_t common = std::min(m, len);
+        std::move(src.begin(), src.begin() + common, begin() + start);
+        if (m < len)
+            erase(begin() + start + m, begin() + start + len);
+        else if (m > len)
+            insert(begin() + start + len, std::make_move_iterator(src.begin() + common),
+                   std::make_move_iterator(src.end()));
+    }
+
+    // 所有元素的类型相同时返回其类型标签，否则返回空
+    const void *common_tag() const noexcept {
+        if (empty())
+            return nullptr;
+        const void *tag = front().tag();
+        for (const auto &x: *this) {
+            if (x.tag() != tag)
+                return nullptr;
+        }
+        return tag;
+    }
+
+    // 类型不同的元素必然不相等，因此只需在类型标签相同的元素中直接比较值，对混合类型的列表同样适用
+    struct fast_count {
+        const plist &pl;
+        const pcell &pc;
+        size_t res;
+        template<typename T>
+        void apply() {
+            const void *tag = pc.tag();
+            const T &v = pc.get_unchecked<T>();
+            for (const auto &x: pl)
+                res += x.tag() == tag && x.get_unchecked<T>() == v;
+        }
+    };
+    struct fast_find {
+        const plist &pl;
+        const pcell &pc;
+        const_iterator res;
+        template<typename T>
+        void apply() {
+            const void *tag = pc.tag();
+            const T &v = pc.get_unchecked<T>();
+            res = std::find_if(pl.begin(), pl.end(), [&](const pcell &x) {
+                return x.tag() == tag && x.get_unchecked<T>() == v;
+            });
+        }
+    };
+    struct fast_remove {
+        plist &pl;
+        const pcell &pc;
+        template<typename T>
+        void apply() {
+            const void *tag = pc.tag();
+            const T v = pc.get_unchecked<T>(); // pc可能就是列表中的元素
+            pl.erase(std::remove_if(pl.begin(), pl.end(), [&](const pcell &x) {
+                return x.tag() == tag && x.get_unchecked<T>() == v;
+            }), pl.end());
+        }
+    };
+    // 列表中元素的类型全部相同时，将值取出到连续的缓冲区中排序，再按顺序放回各个元素中。
+    // 相等的整数和字符串无法区分，可以用不稳定的排序；浮点数有0.0和-0.0之分，需要用稳定排序。
+    // 逆序时用std::greater，仍然是严格弱序
+    struct fast_sort {
+        plist &pl;
+        bool rvs;
+        const par *pol; // 不为空时并行排序
+        template<typename T, typename C>
+        void sort_values(std::vector<T> &vals, C cmp) const {
+            if (pol)
+                detail::__parallel_stable_sort(vals, cmp, *pol);
+            else if (std::is_floating_point<T>::value)
+                std::stable_sort(vals.begin(), vals.end(), cmp);
+            else
+                std::sort(vals.begin(), vals.end(), cmp);
+        }
+        template<typename T>
+        void apply() {
+            std::vector<T> vals;
+            vals.reserve(pl.size());
+            for (auto &x: pl)
+                vals.push_back(std::move(x.get_unchecked<T>()));
+            !rvs ? sort_values(vals, std::less<T>()) : sort_values(vals, std::greater<T>());
+            auto it = vals.begin();
+            for (auto &x: pl)
+                x.get_unchecked<T>() = std::move(*it++);
+        }
+    };
+
+    // 全序排序时每个元素的排序依据，事先计算一次
+    struct total_key {
+        int group; // 0为空值，1为算术类型，2为其他类型
+        bool ordered; // 能否和自身比较，NaN和不支持比较的对象不能
+        long double num;
+        const pcell *cell;
+        const plist *list; // 元素为plist时指向它，按全序逐个比较其中的元素
+        size_t pos;
+
+        total_key(const pcell &c, size_t i) : group(0), ordered(true), num(0), cell(&c), list(nullptr), pos(i) {
+            if (!c.has_value())
+                return;
+            if (c.hdr->number) {
+                group = 1, num = c.hdr->number(c), ordered = num == num;
+            } else if ((list = c.try_cast<plist>())) {
+                group = 2;
+            } else {
+                group = 2, ordered = c.hdr->compare(c, c) != ordering::incomparable;
+            }
+        }
+
+        // 先按分组，其他类型再按类型名，能比较的元素在前，最后按值
+        bool before(const total_key &b) const {
+            if (group != b.group)
+                return group < b.group;
+            if (group == 2 && cell->tag() != b.cell->tag()) {
+                int c = std::strcmp(cell->type().name(), b.cell->type().name());
+                return c ? c < 0 : std::less<const void *>()(cell->tag(), b.cell->tag());
+            }
+            if (ordered != b.ordered)
+                return ordered;
+            if (!ordered || group == 0)
+                return false;
+            if (group == 1)
+                return num < b.num;
+            return (list ? list->compare(*b.list, total_order) : cell->hdr->compare(*cell, *b.cell)) == ordering::less;
+        }
+    };
+
+    // 按顺序保留在pl中出现（keep为真）或不出现（keep为假）的元素，并去除重复的元素
+    plist select_by(const plist &pl, bool keep) const {
+        detail::__cell_set other, seen;
+        other.reserve(pl.size());
+        for (const auto &x: pl)
+            other.insert(&x);
+        plist res;
+        for (const auto &x: *this) {
+            if ((other.count(&x) != 0) == keep && seen.insert(&x).second)
+                res.push_back(x);
+        }
+        return res;
+    }
+
+public:
+    using std::vector<pcell>::vector;
+    using std::vector<pcell>::insert;
+    using std::vector<pcell>::emplace;
+    using std::vector<pcell>::emplace_back;
+
+    // 在列表末尾或pos之前用args原位构造T的对象，不经过临时的pcell，堆上的对象只分配一次
+    template<typename T, typename ...Args>
+    pcell &emplace_back(Args &&...args) {
+        std::vector<pcell>::emplace_back(in_place_type_t<T>(), std::forward<Args>(args)...);
+        return back();
+    }
+    template<typename T, typename ...Args>
+    iterator emplace(const_iterator pos, Args &&...args) {
+        return std::vector<pcell>::emplace(pos, in_place_type_t<T>(), std::forward<Args>(args)...);
+    }
+
+    // 直接索引访问，支持负数索引，越界时抛出std::out_of_range。返回对应pcell的引用
+    pcell &operator[](std::ptrdiff_t i) {
+        return std::vector<pcell>::operator[](index_trans(i));
+    }
+    const pcell &operator[](std::ptrdiff_t i) const {
+        return std::vector<pcell>::operator[](index_trans(i));
+    }
+    // 切片索引访问，返回原列表的视图，不拷贝元素。视图可以隐式转换为新的plist
+    plist_view operator[](pslice sl) {
+        std::ptrdiff_t start, len = sl.indices(size(), start);
+        return plist_view(*this, start, sl.step(), len);
+    }
+    const_plist_view operator[](pslice sl) const {
+        std::ptrdiff_t start, len = sl.indices(size(), start);
+        return const_plist_view(*this, start, sl.step(), len);
+    }
+
+    // 删除切片中的元素，和python的del l[a:b:c]一样。只移动一遍剩下的元素
+    using std::vector<pcell>::erase;
+    void erase(pslice sl) {
+        detail::__stat_timer timer(detail::__stat_kind::slice);
+        std::ptrdiff_t start, len = sl.indices(size(), start), step = sl.step();
+        if (len == 0)
+            return;
+        if (step < 0)
+            start += (len - 1) * step, step = -step;
+        if (step == 1) {
+            erase(begin() + start, begin() + start + len);
+            return;
+        }
+        auto &v = base();
+        size_t w = start, del = start, n = size(), k = 0;
+        for (size_t r = start; r < n; ++r) {
+            if (k < size_t(len) && r == del) {
+                ++k, del += step;
+                continue;
+            }
+            v[w++] = std::move(v[r]);
+        }
+        erase(begin() + w, end());
+    }
+
+    // 列表连接。结果的长度事先已知，一次性分配好空间；右值参数中的元素直接移动，不再拷贝
+    friend plist operator+(const plist &a, const plist &b) {
+        plist res;
+        res.reserve(a.size() + b.size());
+        res.insert(res.end(), a.begin(), a.end());
+        res.insert(res.end(), b.begin(), b.end());
+        return res;
+    }
+    friend plist operator+(plist &&a, const plist &b) {
+        a += b;
+        return std::move(a);
+    }
+    friend plist operator+(const plist &a, plist &&b) {
+        b.insert(b.begin(), a.begin(), a.end());
+        return std::move(b);
+    }
+    friend plist operator+(plist &&a, plist &&b) {
+        a += std::move(b);
+        return std::move(a);
+    }
+    plist &operator+=(const plist &pl) {
+        size_t len = pl.size();
+        grow(size() + len);
+        for (size_t i = 0; i < len; ++i) // pl可能就是自身，空间已经预留好，不会失效
+            push_back(pl.base()[i]);
+        return *this;
+    }
+    plist &operator+=(plist &&pl) {
+        if (&pl == this)
+            return *this += static_cast<const plist &>(pl);
+        grow(size() + pl.size());
+        insert(end(), std::make_move_iterator(pl.begin()), std::make_move_iterator(pl.end()));
+        pl.clear();
+        return *this;
+    }
+    // 列表拷贝。和python一样，复制0次得到空列表
+    friend plist operator*(size_t time, const plist &pl) {
+        return pl * time;
+    }
+    friend plist operator*(const plist &pl, size_t time) {
+        plist res;
+        res.reserve(pl.size() * time);
+        for (size_t t = 0; t < time; ++t)
+            res.insert(res.end(), pl.begin(), pl.end());
+        return res;
+    }
+    friend plist operator*(size_t time, plist &&pl) {
+        return std::move(pl) * time;
+    }
+    friend plist operator*(plist &&pl, size_t time) {
+        pl *= time;
+        return std::move(pl);
+    }
+    plist &operator*=(size_t time) {
+        if (time == 0) {
+            clear();
+            return *this;
+        }
+        size_t old_len = size();
+        grow(old_len * time);
+        auto &v = base();
+        for (size_t t = 1; t < time; ++t) {
+            for (size_t i = 0; i < old_len; ++i)
+                push_back(v[i]);
+        }
+        return *this;
+    }
+    // 将列表的输出写入buf，格式和<<相同。嵌套的列表用显式的栈处理，不递归
+    void write_to(pbuffer &buf) const;
+    // 列表输出。输出流为默认格式时先写入线程的缓冲区，再一次性写入流中
+    friend std::ostream &operator<<(std::ostream &os, const plist &pl) {
+        if (detail::__default_format(os)) {
+            detail::__buffer_lease lease;
+            pl.write_to(lease.get());
+            return os.write(lease.get().data(), lease.get().size());
+        }
+        if (pl.empty())
+            return os << "[]";
+        os << '[';
+        auto it = pl.begin(), stop = pl.end();
+        os << *it++;
+        for (; it != stop; ++it)
+            os << ", " << *it;
+        os << ']';
+        return os;
+    }
+    // 列表转换为字符串
+    explicit operator std::string() const {
+        detail::__buffer_lease lease;
+        write_to(lease.get());
+        return lease.get().str();
+    }
+
+    // python API
+    size_t count(const pcell &pc) const {
+        fast_count fc{*this, pc, 0};
+        return detail::__dispatch(fast_types(), pc.tag(), fc) ? fc.res : std::count(begin(), end(), pc);
+    }
+    std::ptrdiff_t index(const pcell &pc) const {
+        fast_find ff{*this, pc, end()};
+        auto it = detail::__dispatch(fast_types(), pc.tag(), ff) ? ff.res : std::find(begin(), end(), pc);
+        return it == end() ? -1 : it - begin();
+    }
+    // 右值直接移动进列表。l.append(std::string(...))只构造一次临时的pcell，不再拷贝
+    void append(const pcell &pc) {
+        push_back(pc);
+    }
+    void append(pcell &&pc) {
+        push_back(std::move(pc));
+    }
+    // 在下标i之前插入，和python的l.insert(i, x)一样：支持负数索引，越界时插入到开头或末尾
+    void insert(std::ptrdiff_t i, const pcell &pc) {
+        insert(begin() + insert_pos(i), pc);
+    }
+    void insert(std::ptrdiff_t i, pcell &&pc) {
+        insert(begin() + insert_pos(i), std::move(pc));
+    }
+    void extend(const plist &pl) {
+        *this += pl;
+    }
+    void extend(plist &&pl) {
+        *this += std::move(pl);
+    }
+    void remove(const pcell &pc) {
+        fast_remove fr{*this, pc};
+        if (!detail::__dispatch(fast_types(), pc.tag(), fr))
+            erase(std::remove(begin(), end(), pc), end());
+    }
+    void reverse() {
         std::reverse(begin(), end());
     }
 
+    // 基于哈希的集合操作，元素的类型需要特化std::hash，否则抛出bad_pcell_hash
+    // 去除重复的元素，保留每个值第一次出现的位置，和python中的list(dict.fromkeys(l))一样
+    plist unique() const {
+        detail::__cell_set seen;
+        seen.reserve(size());
+        plist res;
+        for (const auto &x: *this) {
+            if (seen.insert(&x).second)
+                res.push_back(x);
+        }
+        return res;
+    }
+    // 交集和差集：按原来的顺序保留在pl中出现（不出现）的元素，结果中没有重复的元素
+    plist intersect(const plist &pl) const {
+        return select_by(pl, true);
+    }
+    plist difference(const plist &pl) const {
+        return select_by(pl, false);
+    }
+    // 建立哈希索引，之后反复的index、count查找都只需一次哈希查找
+    plist_index hash_index() const;
+
+    // 把存放在堆上的对象按列表的顺序重新分配到一整块连续的内存中，嵌套的列表递归整理，
+    // 排序等重排之后顺序遍历时不再随机访问内存。内存块在其中最后一个对象释放时释放，
+    // 整理后的对象可以比列表活得更久。对象的移动构造抛出异常时，已经整理的元素保留在新的位置
+    plist &compact() {
+        size_t bytes = 0;
+        compact_size(*this, bytes);
+        if (!bytes)
+            return *this;
+        struct block_guard {
+            detail::__compact_block *block;
+            ~block_guard() { block->release(); }
+        } guard{detail::__compact_block::create(bytes)};
+        resource_scope scope(guard.block);
+        compact_into(*this);
+        return *this;
+    }
+
+    // 按字典序三路比较，元素之间用pcell::compare，第一对不相等的元素决定结果
+    ordering compare(const plist &rhs) const {
+        const auto &a = base(), &b = rhs.base();
+        for (size_t i = 0, n = std::min(a.size(), b.size()); i < n; ++i) {
+            ordering res = a[i].compare(b[i]);
+            if (res != ordering::equal)
+                return res;
+        }
+        return a.size() < b.size() ? ordering::less : b.size() < a.size() ? ordering::greater : ordering::equal;
+    }
+    // 按字典序全序比较，元素之间的规则和sort(total_order)相同，嵌套的列表同样逐个全序比较。
+    // 结果只有不能和自身比较的元素（见sort(total_order)）之间会是incomparable
+    ordering compare(const plist &rhs, total_order_t) const {
+        const auto &a = base(), &b = rhs.base();
+        for (size_t i = 0, n = std::min(a.size(), b.size()); i < n; ++i) {
+            total_key x(a[i], i), y(b[i], i);
+            if (x.before(y))
+                return ordering::less;
+            if (y.before(x))
+                return ordering::greater;
+            if (!x.ordered)
+                return ordering::incomparable;
+        }
+        return a.size() < b.size() ? ordering::less : b.size() < a.size() ? ordering::greater : ordering::equal;
+    }
+
+    // 排序函数，直接比较元素。rvs代表是否逆序排序
+    // 和python一样，排序是稳定的：逆序排序时相等的元素也保持原来的相对顺序。
+    // 通用路径对下标排序后再重排元素，比较时抛出异常不会破坏列表
+    plist &sort(bool rvs = false) {
+        detail::__stat_timer timer(detail::__stat_kind::sort);
+        fast_sort fs{*this, rvs, nullptr};
+        if (detail::__dispatch(fast_types(), common_tag(), fs))
+            return *this;
+        const auto &v = base();
+        std::vector<size_t> order(size());
+        for (size_t i = 0, len = order.size(); i < len; ++i)
+            order[i] = i;
+        !rvs
+        ? std::stable_sort(order.begin(), order.end(),
+                           [&](size_t a, size_t b) {
+                               return v[a] < v[b];
+                           })
+        : std::stable_sort(order.begin(), order.end(),
+                           [&](size_t a, size_t b) {
+                               return v[b] < v[a];
+                           });
+        permute(order);
+        return *this;
+    }
     // 排序函数。其中key是一个一元函数（类型为A => B），和python中的一样。rvs代表是否逆序排序
-    template<typename F = std::function<const pcell &(const pcell &)>>
-    plist &sort(bool rvs = false, F key = [](const pcell &x) -> const pcell & { return x; }) {
+    // 和python一样，每个元素只计算一次key，并且排序是稳定的
+    template<typename F>
+    plist &sort(bool rvs, F key) {
+        detail::__stat_timer timer(detail::__stat_kind::sort);
         using arg_type = first_arg_type<F>;
+        using store = detail::__key_store<typename ft::function_traits<F>::result_type>;
+        using entry = std::pair<typename store::type, size_t>;
+        std::vector<entry> keys;
+        keys.reserve(size());
+        for (size_t i = 0, len = size(); i < len; ++i)
+            keys.emplace_back(store::make(key(base()[i].cast<arg_type>())), i);
         !rvs
-        ? std::sort(begin(), end(),
-                    [&](const pcell &a, const pcell &b) {
-                        return key(a.cast<arg_type>()) < key(b.cast<arg_type>());
-                    })
-        : std::sort(begin(), end(),
-                    [&](const pcell &a, const pcell &b) {
-                        return !(key(a.cast<arg_type>()) < key(b.cast<arg_type>()));
-                    });
+        ? std::stable_sort(keys.begin(), keys.end(),
+                           [](const entry &a, const entry &b) {
+                               return store::get(a.first) < store::get(b.first);
+                           })
+        : std::stable_sort(keys.begin(), keys.end(),
+                           [](const entry &a, const entry &b) {
+                               return store::get(b.first) < store::get(a.first);
+                           });
+        std::vector<size_t> order;
+        order.reserve(keys.size());
+        for (const auto &k: keys)
+            order.push_back(k.second);
+        keys.clear();
+        permute(order);
         return *this;
     }
 
+    // 全序排序，可以对混合类型的列表排序，不会抛出bad_comparison（元素自身的<和==抛出的异常除外，此时列表保持不变）。空值在最前；其次是算术类型的元素，
+    // 不论具体类型都按数值比较，NaN排在它们的最后；其他类型的元素按类型名分组，组内按该类型的<和==排序，
+    // 不能和自身比较的元素（不支持比较的类型）排在组的最后。和sort一样是稳定的
+    plist &sort(total_order_t, bool rvs = false) {
+        detail::__stat_timer timer(detail::__stat_kind::sort);
+        fast_sort fs{*this, rvs, nullptr};
+        if (detail::__dispatch(ordered_types(), common_tag(), fs))
+            return *this;
+        const auto &v = base();
+        std::vector<total_key> keys;
+        keys.reserve(size());
+        for (size_t i = 0, len = size(); i < len; ++i)
+            keys.emplace_back(v[i], i);
+        !rvs
+        ? std::stable_sort(keys.begin(), keys.end(), [](const total_key &a, const total_key &b) {
+            return a.before(b);
+        })
+        : std::stable_sort(keys.begin(), keys.end(), [](const total_key &a, const total_key &b) {
+            return b.before(a);
+        });
+        std::vector<size_t> order;
+        order.reserve(keys.size());
+        for (const auto &k: keys)
+            order.push_back(k.pos);
+        keys.clear();
+        permute(order);
+        return *this;
+    }
+
+    // 返回惰性求值的操作链，map、filter等操作在一遍遍历中依次完成，只在collect时生成新的列表
+    lazy_list<detail::__lazy_source> lazy() const;
+
     // 其他常用的列表操作
     template<typename F>
     plist &for_each(F trans) {
@@ -501,6 +2424,7 @@ public:
 
     template<typename F>
     plist map(F mapping) {
+        detail::__stat_timer timer(detail::__stat_kind::map);
         using arg_type = first_arg_type<F>;
         plist res;
         res.reserve(size());
@@ -511,6 +2435,7 @@ public:
 
     template<typename F>
     plist filter(F pred) {
+        detail::__stat_timer timer(detail::__stat_kind::filter);
         using arg_type = first_arg_type<F>;
         plist res;
         for (const auto &x: *this) {
@@ -519,8 +2444,586 @@ public:
         }
         return res;
     }
+
+    // 以上操作的并行版本，结果和串行版本完全相同。函数会在多个线程中同时被调用
+    template<typename F>
+    plist &for_each(const par &pol, F trans) {
+        using arg_type = first_arg_type<F>;
+        auto &v = base();
+        detail::__parallel_for(size(), pol, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i)
+                trans(v[i].cast<arg_type>());
+        });
+        return *this;
+    }
+
+    template<typename F>
+    plist map(const par &pol, F mapping) {
+        detail::__stat_timer timer(detail::__stat_kind::map);
+        using arg_type = first_arg_type<F>;
+        const auto &v = base();
+        plist res(size());
+        detail::__parallel_for(size(), pol, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; ++i)
+                res.base()[i] = mapping(v[i].cast<arg_type>());
+        });
+        return res;
+    }
+
+    // 先并行地对每块计算谓词并计数，再按各块的计数确定输出位置，并行地把结果按原顺序拷贝过去
+    template<typename F>
+    plist filter(const par &pol, F pred) {
+        detail::__stat_timer timer(detail::__stat_kind::filter);
+        using arg_type = first_arg_type<F>;
+        const auto &v = base();
+        size_t n = size();
+        size_t chunk = pol.chunk ? pol.chunk : std::max<size_t>((n + pol.threads * 4 - 1) / (pol.threads * 4), 1024);
+        size_t blocks = (n + chunk - 1) / chunk;
+        std::vector<char> keep(n);
+        std::vector<size_t> offset(blocks + 1);
+        detail::__parallel_for(blocks, par(pol.threads, 1), [&](size_t b0, size_t b1) {
+            for (size_t b = b0; b < b1; ++b) {
+                for (size_t i = b * chunk, e = std::min(i + chunk, n); i < e; ++i)
+                    offset[b + 1] += keep[i] = static_cast<bool>(pred(v[i].cast<arg_type>()));
+            }
+        });
+        for (size_t b = 0; b < blocks; ++b)
+            offset[b + 1] += offset[b];
+        plist res(offset[blocks]);
+        detail::__parallel_for(blocks, par(pol.threads, 1), [&](size_t b0, size_t b1) {
+            for (size_t b = b0; b < b1; ++b) {
+                size_t k = offset[b];
+                for (size_t i = b * chunk, e = std::min(i + chunk, n); i < e; ++i) {
+                    if (keep[i])
+                        res.base()[k++] = v[i];
+                }
+            }
+        });
+        return res;
+    }
+
+    // 并行的归并排序，和串行版本一样是稳定的
+    plist &sort(const par &pol, bool rvs = false) {
+        detail::__stat_timer timer(detail::__stat_kind::sort);
+        fast_sort fs{*this, rvs, &pol};
+        if (detail::__dispatch(fast_types(), common_tag(), fs))
+            return *this;
+        const auto &v = base();
+        std::vector<size_t> order(size());
+        for (size_t i = 0, len = order.size(); i < len; ++i)
+            order[i] = i;
+        !rvs
+        ? detail::__parallel_stable_sort(order, [&](size_t a, size_t b) { return v[a] < v[b]; }, pol)
+        : detail::__parallel_stable_sort(order, [&](size_t a, size_t b) { return v[b] < v[a]; }, pol);
+        permute(order);
+        return *this;
+    }
+    template<typename F>
+    plist &sort(const par &pol, bool rvs, F key) {
+        detail::__stat_timer timer(detail::__stat_kind::sort);
+        using arg_type = first_arg_type<F>;
+        using store = detail::__key_store<typename ft::function_traits<F>::result_type>;
+        using key_type = typename store::type;
+        const auto &v = base();
+        // key的类型不一定有默认构造函数，每块先各自用emplace_back构造，再依次移动到一起
+        size_t n = size();
+        size_t chunk = pol.chunk ? pol.chunk : std::max<size_t>((n + pol.threads * 4 - 1) / (pol.threads * 4), 1024);
+        size_t blocks = (n + chunk - 1) / chunk;
+        std::vector<std::vector<key_type>> parts(blocks);
+        detail::__parallel_for(blocks, par(pol.threads, 1), [&](size_t b0, size_t b1) {
+            for (size_t b = b0; b < b1; ++b) {
+                size_t i = b * chunk, e = std::min(i + chunk, n);
+                parts[b].reserve(e - i);
+                for (; i < e; ++i)
+                    parts[b].emplace_back(store::make(key(v[i].cast<arg_type>())));
+            }
+        });
+        std::vector<key_type> keys;
+        keys.reserve(n);
+        for (auto &part: parts) {
+            for (auto &k: part)
+                keys.emplace_back(std::move(k));
+            std::vector<key_type>().swap(part);
+        }
+        std::vector<size_t> order(size());
+        for (size_t i = 0, len = order.size(); i < len; ++i)
+            order[i] = i;
+        !rvs
+        ? detail::__parallel_stable_sort(order, [&](size_t a, size_t b) {
+            return store::get(keys[a]) < store::get(keys[b]);
+        }, pol)
+        : detail::__parallel_stable_sort(order, [&](size_t a, size_t b) {
+            return store::get(keys[b]) < store::get(keys[a]);
+        }, pol);
+        keys.clear();
+        permute(order);
+        return *this;
+    }
+};
+
+
+namespace detail {
+
+// 操作链中的元素：来自列表的元素是pcell，需要转换为函数的参数类型；经过map之后的元素已经是具体的值，直接转发
+template<typename A>
+struct __lazy_arg {
+    static A get(const pcell &c) {
+        return c.cast<A>();
+    }
+    template<typename V, typename = typename std::enable_if<
+            !std::is_same<typename std::decay<V>::type, pcell>::value>::type>
+    static V &&get(V &&v) {
+        return std::forward<V>(v);
+    }
+};
+
+template<typename F, int N = 0>
+using __lazy_arg_of = __lazy_arg<typename ft::function_traits<F>::template argument_type<N>>;
+
+// 操作链的每一级都提供run(sink)：把元素依次推给sink，sink返回false时提前停止。
+// 各级在编译期组合在一起，整条链只遍历一遍源列表，也不产生中间列表
+struct __lazy_source {
+    const plist *lst;
+
+    template<typename Sink>
+    bool run(Sink &sink) const {
+        for (const auto &x: *lst) {
+            if (!sink(x))
+                return false;
+        }
+        return true;
+    }
+};
+
+template<typename Src, typename F>
+struct __lazy_map {
+    Src src;
+    F f;
+
+    template<typename Sink>
+    struct sink_type {
+        F &f;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            return sink(f(__lazy_arg_of<F>::get(std::forward<V>(v))));
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        sink_type<Sink> s{f, sink};
+        return src.run(s);
+    }
+};
+
+template<typename Src, typename F>
+struct __lazy_filter {
+    Src src;
+    F pred;
+
+    template<typename Sink>
+    struct sink_type {
+        F &pred;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            return pred(__lazy_arg_of<F>::get(v)) ? sink(std::forward<V>(v)) : true;
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        sink_type<Sink> s{pred, sink};
+        return src.run(s);
+    }
+};
+
+template<typename Src>
+struct __lazy_take {
+    Src src;
+    size_t n;
+
+    template<typename Sink>
+    struct sink_type {
+        size_t left;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            --left;
+            return sink(std::forward<V>(v)) && left > 0;
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        if (n == 0)
+            return true;
+        sink_type<Sink> s{n, sink};
+        return src.run(s) || s.left == 0;
+    }
+};
+
+template<typename Src>
+struct __lazy_skip {
+    Src src;
+    size_t n;
+
+    template<typename Sink>
+    struct sink_type {
+        size_t left;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            if (left > 0)
+                return --left, true;
+            return sink(std::forward<V>(v));
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        sink_type<Sink> s{n, sink};
+        return src.run(s);
+    }
+};
+
+// 和python的enumerate一样，产生(序号, 元素)
+template<typename Src>
+struct __lazy_enumerate {
+    Src src;
+    size_t start;
+
+    template<typename Sink>
+    struct sink_type {
+        size_t i;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            return sink(std::pair<size_t, typename std::decay<V>::type>(i++, std::forward<V>(v)));
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        sink_type<Sink> s{start, sink};
+        return src.run(s);
+    }
+};
+
+// 和python的zip一样，产生(元素, 另一个列表中对应位置的元素)，在较短的一方结束时停止
+template<typename Src>
+struct __lazy_zip {
+    Src src;
+    const plist *other;
+
+    template<typename Sink>
+    struct sink_type {
+        const plist &other;
+        size_t i;
+        Sink &sink;
+        template<typename V>
+        bool operator()(V &&v) {
+            if (i >= other.size())
+                return false;
+            const pcell &o = other.std::vector<pcell>::operator[](i++);
+            return sink(std::pair<typename std::decay<V>::type, pcell>(std::forward<V>(v), o)) &&
+                   i < other.size();
+        }
+    };
+    template<typename Sink>
+    bool run(Sink &sink) {
+        sink_type<Sink> s{*other, 0, sink};
+        return other->empty() || src.run(s);
+    }
+};
+
+template<typename T, typename F>
+struct __lazy_reducer {
+    T &acc;
+    F &f;
+    template<typename V>
+    bool operator()(V &&v) {
+        acc = f(std::move(acc), __lazy_arg_of<F, 1>::get(std::forward<V>(v)));
+        return true;
+    }
+};
+
+template<typename F>
+struct __lazy_visitor {
+    F &f;
+    template<typename V>
+    bool operator()(V &&v) {
+        f(__lazy_arg_of<F>::get(std::forward<V>(v)));
+        return true;
+    }
+};
+
+struct __lazy_counter {
+    size_t n;
+    template<typename V>
+    bool operator()(V &&) {
+        return ++n, true;
+    }
+};
+
+struct __lazy_collector {
+    plist &res;
+    template<typename V>
+    bool operator()(V &&v) {
+        res.emplace_back(std::forward<V>(v));
+        return true;
+    }
+};
+
+}
+
+// 惰性求值的操作链。map、filter、take、skip、enumerate、zip只是组合出新的操作链，
+// 直到调用reduce、for_each、count、collect等终结操作时才遍历一遍源列表。
+// 操作链不拷贝源列表，源列表必须在操作链使用期间保持有效
+template<typename Src>
+class lazy_list {
+    Src src;
+
+    template<typename S>
+    friend class lazy_list;
+
+public:
+    explicit lazy_list(Src s) : src(std::move(s)) {}
+
+    template<typename F>
+    lazy_list<detail::__lazy_map<Src, F>> map(F f) const {
+        return lazy_list<detail::__lazy_map<Src, F>>({src, std::move(f)});
+    }
+    template<typename F>
+    lazy_list<detail::__lazy_filter<Src, F>> filter(F pred) const {
+        return lazy_list<detail::__lazy_filter<Src, F>>({src, std::move(pred)});
+    }
+    lazy_list<detail::__lazy_take<Src>> take(size_t n) const {
+        return lazy_list<detail::__lazy_take<Src>>({src, n});
+    }
+    lazy_list<detail::__lazy_skip<Src>> skip(size_t n) const {
+        return lazy_list<detail::__lazy_skip<Src>>({src, n});
+    }
+    lazy_list<detail::__lazy_enumerate<Src>> enumerate(size_t start = 0) const {
+        return lazy_list<detail::__lazy_enumerate<Src>>({src, start});
+    }
+    lazy_list<detail::__lazy_zip<Src>> zip(const plist &other) const {
+        return lazy_list<detail::__lazy_zip<Src>>({src, &other});
+    }
+
+    // 和python的functools.reduce一样，f的类型为(T, A) => T
+    template<typename T, typename F>
+    T reduce(T init, F f) {
+        detail::__lazy_reducer<T, F> r{init, f};
+        src.run(r);
+        return init;
+    }
+    template<typename F>
+    void for_each(F f) {
+        detail::__lazy_visitor<F> v{f};
+        src.run(v);
+    }
+    size_t count() {
+        detail::__lazy_counter c{0};
+        src.run(c);
+        return c.n;
+    }
+    // 生成新的列表
+    plist collect() {
+        plist res;
+        detail::__lazy_collector c{res};
+        src.run(c);
+        return res;
+    }
+    plist to_plist() {
+        return collect();
+    }
+};
+
+inline lazy_list<detail::__lazy_source> plist::lazy() const {
+    return lazy_list<detail::__lazy_source>({this});
+}
+
+
+// 列表的哈希索引，记录每个值第一次出现的位置和出现的次数。
+// 索引中保存的是元素的指针，列表被修改后索引失效，需要重新建立
+class plist_index {
+    struct entry {
+        size_t first, count;
+    };
+    std::unordered_map<const pcell *, entry, detail::__cell_ref_hash, detail::__cell_ref_equal> map;
+
+public:
+    explicit plist_index(const plist &pl) {
+        map.reserve(pl.size());
+        size_t i = 0;
+        for (const auto &x: pl)
+            ++map.insert({&x, entry{i++, 0}}).first->second.count;
+    }
+
+    // 和plist中的同名函数相同
+    size_t count(const pcell &pc) const {
+        auto it = map.find(&pc);
+        return it == map.end() ? 0 : it->second.count;
+    }
+    std::ptrdiff_t index(const pcell &pc) const {
+        auto it = map.find(&pc);
+        return it == map.end() ? -1 : static_cast<std::ptrdiff_t>(it->second.first);
+    }
+    bool contains(const pcell &pc) const {
+        return map.find(&pc) != map.end();
+    }
+    // 不同的值的个数
+    size_t size() const {
+        return map.size();
+    }
 };
 
+inline plist_index plist::hash_index() const {
+    return plist_index(*this);
+}
+
+// 写时复制的列表。拷贝时只增加引用计数，多个副本共享同一个plist，第一次通过非常量的接口修改时才拷贝出独立的plist。
+// 放在pcell中时，拷贝pcell同样只增加引用计数，因此由cow_plist嵌套而成的列表按值传递时不会拷贝整棵树。
+// 对外仍然是值语义：修改一个副本不会影响其他副本。注意共享的plist中直接嵌套的plist在拷贝时仍是深拷贝
+class cow_plist {
+    std::shared_ptr<plist> ptr; // 为空表示空列表
+    // 交出过可写的引用（mut、非常量的operator[]）后为false，之后的拷贝都深拷贝，
+    // 否则通过之前交出的引用会修改到共享的副本。和写时复制的字符串一样，clear之前保持为false
+    bool shareable{true};
+
+    static const plist &empty_list() {
+        static const plist pl;
+        return pl;
+    }
+    // 拷贝时使用的plist
+    static std::shared_ptr<plist> share(const cow_plist &cl) {
+        return cl.shareable || !cl.ptr ? cl.ptr : std::make_shared<plist>(*cl.ptr);
+    }
+    // 保证独占plist：被其他副本共享时先拷贝出独立的plist。修改列表的操作都经过这里，不交出引用
+    plist &unique() {
+        if (!ptr)
+            ptr = std::make_shared<plist>();
+        else if (ptr.use_count() > 1)
+            ptr = std::make_shared<plist>(*ptr);
+        return *ptr;
+    }
+
+public:
+    cow_plist() = default;
+    cow_plist(plist pl) : ptr(std::make_shared<plist>(std::move(pl))) {}
+    cow_plist(std::initializer_list<pcell> il) : ptr(std::make_shared<plist>(il)) {}
+    cow_plist(const cow_plist &cl) : ptr(share(cl)) {}
+    // 移动后之前交出的引用指向新对象的列表，因此不可共享的状态一并转移
+    cow_plist(cow_plist &&cl) noexcept : ptr(std::move(cl.ptr)), shareable(cl.shareable) {
+        cl.shareable = true;
+    }
+    cow_plist &operator=(const cow_plist &cl) {
+        if (this != &cl)
+            ptr = share(cl), shareable = true;
+        return *this;
+    }
+    cow_plist &operator=(cow_plist &&cl) noexcept {
+        if (this != &cl)
+            ptr = std::move(cl.ptr), shareable = cl.shareable, cl.shareable = true;
+        return *this;
+    }
+
+    // 只读访问，不会拷贝
+    const plist &get() const noexcept {
+        return ptr ? *ptr : empty_list();
+    }
+    operator const plist &() const noexcept {
+        return get();
+    }
+    // 可写访问。被其他副本共享时先拷贝出独立的plist；之后这个对象不再和拷贝共享列表
+    plist &mut() {
+        plist &pl = unique();
+        shareable = false;
+        return pl;
+    }
+    // 共享同一个plist的副本个数
+    long use_count() const noexcept {
+        return ptr.use_count();
+    }
+
+    size_t size() const { return get().size(); }
+    bool empty() const { return get().empty(); }
+    plist::const_iterator begin() const { return get().begin(); }
+    plist::const_iterator end() const { return get().end(); }
+
+    const pcell &operator[](std::ptrdiff_t i) const {
+        return get()[i];
+    }
+    // 可写的元素引用，和mut一样之后这个对象不再和拷贝共享列表
+    pcell &operator[](std::ptrdiff_t i) {
+        return mut()[i];
+    }
+    const_plist_view operator[](pslice sl) const {
+        return get()[sl];
+    }
+
+    // python API，修改列表的操作都经过unique，不交出引用，之后仍可以共享
+    size_t count(const pcell &pc) const { return get().count(pc); }
+    std::ptrdiff_t index(const pcell &pc) const { return get().index(pc); }
+    void append(const pcell &pc) { unique().append(pc); }
+    void append(pcell &&pc) { unique().append(std::move(pc)); }
+    void insert(std::ptrdiff_t i, const pcell &pc) { unique().insert(i, pc); }
+    void insert(std::ptrdiff_t i, pcell &&pc) { unique().insert(i, std::move(pc)); }
+    void extend(const plist &pl) { unique().extend(pl); }
+    void remove(const pcell &pc) { unique().remove(pc); }
+    void reverse() { unique().reverse(); }
+    void pop_back() { unique().pop_back(); }
+    void erase(pslice sl) { unique().erase(sl); }
+    // 清空后之前交出的引用都已失效，可以重新共享
+    void clear() { ptr.reset(), shareable = true; }
+    cow_plist &sort(bool rvs = false) {
+        unique().sort(rvs);
+        return *this;
+    }
+    template<typename F>
+    cow_plist &sort(bool rvs, F key) {
+        unique().sort(rvs, key);
+        return *this;
+    }
+
+    // 共享同一个plist时不需要逐个比较元素
+    friend bool operator==(const cow_plist &a, const cow_plist &b) {
+        return a.ptr == b.ptr || a.get() == b.get();
+    }
+    friend bool operator!=(const cow_plist &a, const cow_plist &b) {
+        return !(a == b);
+    }
+    friend std::ostream &operator<<(std::ostream &os, const cow_plist &cl) {
+        return os << cl.get();
+    }
+};
+
+inline void plist::write_to(pbuffer &buf) const {
+    std::vector<std::pair<const plist *, size_t>> stack;
+    const plist *cur = this;
+    size_t i = 0;
+    buf.append('[');
+    for (;;) {
+        if (i == cur->size()) {
+            buf.append(']');
+            if (stack.empty())
+                return;
+            cur = stack.back().first, i = stack.back().second;
+            stack.pop_back();
+            continue;
+        }
+        if (i != 0)
+            buf.append(", ", 2);
+        const pcell &x = cur->base()[i++];
+        const plist *sub = x.isa<plist>() ? &x.get_unchecked<plist>()
+                                          : x.isa<cow_plist>() ? &x.get_unchecked<cow_plist>().get() : nullptr;
+        if (sub) {
+            stack.emplace_back(cur, i);
+            cur = sub, i = 0;
+            buf.append('[');
+            continue;
+        }
+        x.write_to(buf);
+    }
+}
+
 }
 
 namespace std {
@@ -529,7 +3032,13 @@ void swap(crz::pcell &a, crz::pcell &b) {
     a.swap(b);
 }
 
-#undef format
+// 特化std::hash，pcell可以直接放入std::unordered_set等容器
+template<>
+struct hash<crz::pcell> {
+    size_t operator()(const crz::pcell &c) const {
+        return c.hash();
+    }
+};
 
 }
 
@@ -0,0 +1,549 @@
+#ifndef __CRZ_PLIST_IO_HH__
+#define __CRZ_PLIST_IO_HH__
+
+#include "plist.hh"
+#include <cstdint>
+#include <typeindex>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace crz {
+
+// 二进制格式（按本机字节序存储，不能在字节序不同的机器之间交换）：
+//   文件：魔数"PLST"、u32版本号，之后是一个plist值
+//   值：u32类型编号，之后是内容
+//     空值：无内容；算术类型：原始字节；std::string：u64长度和字符；
+//     plist：u64元素个数n、n个u64偏移（相对于内容的开头）、n个值。偏移表使映射加载时可以直接定位第i个元素
+//     用户类型：由注册时给出的函数读写
+
+// 读写二进制格式时出错：数据格式错误、遇到未注册的类型等
+class bad_serialization : public std::runtime_error {
+public:
+    explicit bad_serialization(const std::string &what) : std::runtime_error("bad serialization: " + what) {}
+};
+
+class oarchive;
+
+class iarchive;
+
+namespace detail {
+
+// 类型编号到读写函数的注册表。内置类型使用256以下的编号，用户类型使用256及以上的编号
+class __type_registry {
+public:
+    struct entry {
+        uint32_t id;
+        const std::type_info *info;
+        std::function<void(oarchive &, const pcell &)> write;
+        std::function<pcell(iarchive &)> read;
+    };
+
+    enum : uint32_t {
+        none_id = 0,
+        string_id = 15,
+        plist_id = 16,
+        user_id = 256,
+    };
+
+    static __type_registry &instance() {
+        static __type_registry reg;
+        return reg;
+    }
+
+    const entry &by_type(const std::type_info &info) const {
+        auto it = writers.find(std::type_index(info));
+        if (it == writers.end())
+            throw bad_serialization(std::string("unregistered type ") + info.name());
+        return it->second;
+    }
+    const entry &by_id(uint32_t id) const {
+        auto it = readers.find(id);
+        if (it == readers.end())
+            throw bad_serialization("unknown type id " + std::to_string(id));
+        return it->second;
+    }
+
+    // 注册一个类型。read为空表示该类型只写出，读入时由同一编号的其他类型负责（如const char *写出为std::string）
+    void add(uint32_t id, const std::type_info &info,
+             std::function<void(oarchive &, const pcell &)> write, std::function<pcell(iarchive &)> read) {
+        if (writers.count(std::type_index(info)))
+            throw std::invalid_argument(std::string("type ") + info.name() + " is already registered");
+        if (read && readers.count(id))
+            throw std::invalid_argument("type id " + std::to_string(id) + " is already registered");
+        writers[std::type_index(info)] = entry{id, &info, std::move(write), nullptr};
+        if (read)
+            readers[id] = entry{id, &info, nullptr, std::move(read)};
+    }
+
+private:
+    std::unordered_map<std::type_index, entry> writers;
+    std::unordered_map<uint32_t, entry> readers;
+
+    __type_registry();
+
+    template<typename T>
+    void add_pod(uint32_t id);
+};
+
+}
+
+// 写出二进制数据。不给出输出流时只统计写出的字节数。
+// 列表的偏移表先写入占位，元素都写出后再回填。输出流可以定位时（tellp成功）内容随写随出，缓冲区只保留最近写出的一段，
+// 偏移表仍在缓冲区中时直接修改，已经写入输出流时用seekp回到原处改写；不能定位时（如管道）退回到
+// 把最外层列表的全部内容放在缓冲区中，写完后再写入输出流。以追加模式打开的流不能回填，不要用于写出
+class oarchive {
+    enum : size_t {
+        chunk = 1 << 16, // 可以定位时，缓冲区超过这个大小就写入输出流
+    };
+
+    std::ostream *os{nullptr};
+    std::string buf; // 尚未写入输出流的内容，对应已写出字节中的最后buf.size()个
+    uint64_t n{0};
+    size_t depth{0}; // 正在写出的列表的层数，不为0时偏移表还需要回填
+    bool seekable{false}; // 当前最外层的列表是否写入可以定位的输出流
+    std::streamoff origin{0}; // 可以定位时，第0个字节在输出流中的位置
+
+    void flush() {
+        if (!os->write(buf.data(), buf.size()))
+            throw bad_serialization("write failed");
+        buf.clear();
+    }
+    void flush_if_needed() {
+        if (!depth || (seekable && buf.size() >= chunk))
+            flush();
+    }
+    // 改写已经写出的第pos个字节开始的len个字节
+    void patch(uint64_t pos, const char *p, size_t len) {
+        if (!len)
+            return;
+        uint64_t flushed = n - buf.size();
+        if (pos < flushed) {
+            size_t k = static_cast<size_t>(std::min<uint64_t>(len, flushed - pos));
+            std::streampos end = os->tellp();
+            if (!os->seekp(origin + static_cast<std::streamoff>(pos)) || !os->write(p, k) || !os->seekp(end))
+                throw bad_serialization("write failed");
+            pos += k, p += k, len -= k;
+        }
+        std::memcpy(&buf[static_cast<size_t>(pos - flushed)], p, len);
+    }
+
+public:
+    oarchive() = default;
+    explicit oarchive(std::ostream &os) : os(&os) {}
+
+    // 已经写出的字节数
+    uint64_t bytes() const { return n; }
+
+    void write(const void *p, size_t len) {
+        if (os) {
+            buf.append(static_cast<const char *>(p), len);
+            n += len;
+            flush_if_needed();
+        } else {
+            n += len;
+        }
+    }
+    template<typename T>
+    void write_pod(const T &t) {
+        static_assert(std::is_trivially_copyable<T>::value, "write_pod requires a trivially copyable type");
+        write(&t, sizeof(T));
+    }
+    void write_string(const char *s, size_t len) {
+        write_pod<uint64_t>(len);
+        write(s, len);
+    }
+    void write_string(const std::string &s) {
+        write_string(s.data(), s.size());
+    }
+    // 写出一个值：类型编号和内容
+    void write_cell(const pcell &c) {
+        auto &reg = detail::__type_registry::instance();
+        if (!c.has_value()) {
+            write_pod<uint32_t>(detail::__type_registry::none_id);
+            return;
+        }
+        auto &e = reg.by_type(c.type());
+        write_pod<uint32_t>(e.id);
+        e.write(*this, c);
+    }
+    // 写出plist的内容。每个元素只写出一次，偏移（相对于内容开头）先记录下来，写完所有元素后回填到偏移表中
+    void write_list(const plist &pl) {
+        uint64_t cnt = pl.size(), first = n;
+        if (!os) {
+            n += sizeof(cnt) + cnt * sizeof(uint64_t);
+            for (const auto &x: pl)
+                write_cell(x);
+            return;
+        }
+        if (!depth) {
+            std::streampos pos = os->tellp();
+            seekable = pos != std::streampos(-1);
+            if (seekable)
+                origin = static_cast<std::streamoff>(pos) - static_cast<std::streamoff>(n);
+        }
+        ++depth;
+        write_pod(cnt);
+        uint64_t table = n;
+        for (uint64_t k, left = cnt * sizeof(uint64_t); left; left -= k) {
+            k = std::min<uint64_t>(left, chunk);
+            buf.append(static_cast<size_t>(k), '\0');
+            n += k;
+            flush_if_needed();
+        }
+        std::vector<uint64_t> offsets;
+        offsets.reserve(cnt);
+        for (const auto &x: pl) {
+            offsets.push_back(n - first);
+            write_cell(x);
+        }
+        patch(table, reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        --depth;
+        flush_if_needed();
+    }
+};
+
+// 读入二进制数据，数据来自输入流或者一段内存
+class iarchive {
+    enum : uint64_t {
+        chunk = 1 << 16, // 从输入流中分块读入或跳过的大小
+    };
+
+    std::istream *is{nullptr};
+    const char *cur{nullptr}, *stop{nullptr};
+
+public:
+    explicit iarchive(std::istream &is) : is(&is) {}
+    iarchive(const char *first, const char *last) : cur(first), stop(last) {}
+
+    void read(void *p, size_t len) {
+        if (is) {
+            if (!is->read(static_cast<char *>(p), len))
+                throw bad_serialization("unexpected end of data");
+            return;
+        }
+        if (static_cast<size_t>(stop - cur) < len)
+            throw bad_serialization("unexpected end of data");
+        std::memcpy(p, cur, len);
+        cur += len;
+    }
+    void skip(uint64_t len) {
+        if (is) {
+            // 分块跳过，长度超出std::streamsize的范围时同样正确
+            for (uint64_t k; len; len -= k) {
+                k = std::min<uint64_t>(len, chunk);
+                if (!is->ignore(k) || static_cast<uint64_t>(is->gcount()) != k)
+                    throw bad_serialization("unexpected end of data");
+            }
+            return;
+        }
+        if (static_cast<uint64_t>(stop - cur) < len)
+            throw bad_serialization("unexpected end of data");
+        cur += len;
+    }
+    template<typename T>
+    T read_pod() {
+        static_assert(std::is_trivially_copyable<T>::value, "read_pod requires a trivially copyable type");
+        T t;
+        read(&t, sizeof(T));
+        return t;
+    }
+    // 字符串的长度来自数据本身，可能是损坏的。从内存读入时先和剩余的长度比较；
+    // 从输入流读入时无法得知剩余的长度，分块读入，数据不足时抛出bad_serialization，不会一次分配过多的内存
+    std::string read_string() {
+        auto len = read_pod<uint64_t>();
+        if (!is) {
+            if (static_cast<uint64_t>(stop - cur) < len)
+                throw bad_serialization("unexpected end of data");
+            std::string s(cur, len);
+            cur += len;
+            return s;
+        }
+        std::string s;
+        if (len > s.max_size())
+            throw bad_serialization("string too long");
+        for (uint64_t got = 0, k; got < len; got += k) {
+            k = std::min<uint64_t>(len - got, chunk);
+            s.resize(got + k);
+            read(&s[got], k);
+        }
+        return s;
+    }
+    // 读入一个值：类型编号和内容
+    pcell read_cell() {
+        auto id = read_pod<uint32_t>();
+        if (id == detail::__type_registry::none_id)
+            return pcell();
+        return detail::__type_registry::instance().by_id(id).read(*this);
+    }
+    // 读入plist的内容，顺序读入时跳过偏移表
+    plist read_list() {
+        auto cnt = read_pod<uint64_t>();
+        if (cnt > (is ? UINT64_MAX : static_cast<uint64_t>(stop - cur)) / sizeof(uint64_t))
+            throw bad_serialization("unexpected end of data");
+        skip(cnt * sizeof(uint64_t));
+        plist res;
+        res.reserve(std::min<uint64_t>(cnt, 1 << 20)); // 输入流中的元素个数未经检查，不预留过多的空间
+        for (uint64_t i = 0; i < cnt; ++i)
+            res.push_back(read_cell());
+        return res;
+    }
+};
+
+namespace detail {
+
+template<typename T>
+void __type_registry::add_pod(uint32_t id) {
+    add(id, typeid(T),
+        [](oarchive &ar, const pcell &c) { ar.write_pod(c.cast<const T &>()); },
+        [](iarchive &ar) { return pcell(ar.read_pod<T>()); });
+}
+
+inline __type_registry::__type_registry() {
+    add_pod<bool>(1);
+    add_pod<char>(2);
+    add_pod<signed char>(3);
+    add_pod<unsigned char>(4);
+    add_pod<short>(5);
+    add_pod<unsigned short>(6);
+    add_pod<int>(7);
+    add_pod<unsigned int>(8);
+    add_pod<long>(9);
+    add_pod<unsigned long>(10);
+    add_pod<long long>(11);
+    add_pod<unsigned long long>(12);
+    add_pod<float>(13);
+    add_pod<double>(14);
+    add(string_id, typeid(std::string),
+        [](oarchive &ar, const pcell &c) { ar.write_string(c.cast<const std::string &>()); },
+        [](iarchive &ar) { return pcell(ar.read_string()); });
+    // 字符串字面量写出为std::string，读入后的类型也是std::string
+    add(string_id, typeid(const char *),
+        [](oarchive &ar, const pcell &c) {
+            const char *s = c.cast<const char *>();
+            ar.write_string(s, std::strlen(s));
+        }, nullptr);
+    add(plist_id, typeid(plist),
+        [](oarchive &ar, const pcell &c) { ar.write_list(c.cast<const plist &>()); },
+        [](iarchive &ar) { return pcell(ar.read_list()); });
+    // 写时复制的列表按plist写出，读入后的类型是plist
+    add(plist_id, typeid(cow_plist),
+        [](oarchive &ar, const pcell &c) { ar.write_list(c.cast<const cow_plist &>().get()); }, nullptr);
+}
+
+}
+
+// 注册用户类型，id不能小于256。write的类型为void(oarchive &, const T &)，read的类型为T(iarchive &)。
+// 注册需要在读写之前完成，注册本身不是线程安全的
+template<typename T, typename W, typename R>
+void register_type(uint32_t id, W write, R read) {
+    if (id < detail::__type_registry::user_id)
+        throw std::invalid_argument("type id " + std::to_string(id) + " is reserved");
+    detail::__type_registry::instance().add(
+            id, typeid(T),
+            [write](oarchive &ar, const pcell &c) { write(ar, c.cast<const T &>()); },
+            [read](iarchive &ar) { return pcell(read(ar)); });
+}
+
+namespace detail {
+
+constexpr char __plist_magic[4] = {'P', 'L', 'S', 'T'};
+constexpr uint32_t __plist_version = 1;
+
+inline void __read_header(iarchive &ar) {
+    char magic[4];
+    ar.read(magic, sizeof(magic));
+    if (std::memcmp(magic, __plist_magic, sizeof(magic)) != 0)
+        throw bad_serialization("not a plist file");
+    auto ver = ar.read_pod<uint32_t>();
+    if (ver != __plist_version)
+        throw bad_serialization("unsupported version " + std::to_string(ver));
+    if (ar.read_pod<uint32_t>() != __type_registry::plist_id)
+        throw bad_serialization("top-level value is not a plist");
+}
+
+}
+
+// 以二进制格式写出列表
+inline void dump(const plist &pl, std::ostream &os) {
+    oarchive ar(os);
+    ar.write(detail::__plist_magic, sizeof(detail::__plist_magic));
+    ar.write_pod(detail::__plist_version);
+    ar.write_pod<uint32_t>(detail::__type_registry::plist_id);
+    ar.write_list(pl);
+}
+inline void dump(const plist &pl, const std::string &path) {
+    std::ofstream os(path, std::ios::binary);
+    if (!os)
+        throw bad_serialization("cannot open " + path);
+    dump(pl, os);
+}
+
+// 顺序读入dump写出的列表
+inline plist load(std::istream &is) {
+    iarchive ar(is);
+    detail::__read_header(ar);
+    return ar.read_list();
+}
+inline plist load(const std::string &path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        throw bad_serialization("cannot open " + path);
+    return load(is);
+}
+
+
+namespace detail {
+
+// 只读映射的文件，析构时解除映射
+class __mapped_file {
+    const char *data_{nullptr};
+    size_t size_{0};
+
+public:
+    explicit __mapped_file(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw bad_serialization("cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw bad_serialization("cannot map " + path);
+        }
+        void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+            throw bad_serialization("cannot map " + path);
+        data_ = static_cast<const char *>(p), size_ = st.st_size;
+    }
+    __mapped_file(const __mapped_file &) = delete;
+    __mapped_file &operator=(const __mapped_file &) = delete;
+    ~__mapped_file() {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
+}
+
+// 以内存映射的方式加载dump写出的文件，不读入整个列表。
+// 元素在第一次通过operator[]访问时才构造成pcell；get和string_at直接从映射的文件中读取标量和字符串，不构造pcell。
+// 嵌套的列表可以用sub得到同样按需加载的子列表。所有子列表共享同一个映射，最后一个对象析构时解除映射。
+// 按需构造的缓存没有加锁，同一个对象不能在多个线程中同时访问
+class mapped_plist {
+    std::shared_ptr<const detail::__mapped_file> file;
+    const char *first{nullptr}, *last{nullptr}; // 列表的内容
+    size_t len{0};
+    mutable std::vector<pcell> cells;
+    mutable std::vector<bool> built;
+
+    mapped_plist(std::shared_ptr<const detail::__mapped_file> f, const char *b, const char *e) :
+            file(std::move(f)), first(b), last(e) {
+        iarchive ar(first, last);
+        uint64_t cnt = ar.read_pod<uint64_t>();
+        if (static_cast<uint64_t>(last - first) / sizeof(uint64_t) <= cnt)
+            throw bad_serialization("unexpected end of data");
+        len = cnt;
+    }
+
+    size_t index_trans(std::ptrdiff_t i) const {
+        return detail::__index_trans(i, len);
+    }
+    // 第k个元素相对于内容开头的范围[b, e)
+    void bounds(size_t k, uint64_t &b, uint64_t &e) const {
+        e = last - first;
+        std::memcpy(&b, first + sizeof(uint64_t) * (k + 1), sizeof(b));
+        if (k + 1 < len)
+            std::memcpy(&e, first + sizeof(uint64_t) * (k + 2), sizeof(e));
+        if (b > e || e > static_cast<uint64_t>(last - first))
+            throw bad_serialization("bad element offset");
+    }
+    iarchive element(size_t k) const {
+        uint64_t b, e;
+        bounds(k, b, e);
+        return iarchive(first + b, first + e);
+    }
+    const std::type_info &stored_type(uint32_t id) const {
+        return id == detail::__type_registry::none_id
+               ? typeid(void) : *detail::__type_registry::instance().by_id(id).info;
+    }
+
+public:
+    explicit mapped_plist(const std::string &path) {
+        file = std::make_shared<const detail::__mapped_file>(path);
+        iarchive ar(file->data(), file->data() + file->size());
+        detail::__read_header(ar);
+        size_t header = sizeof(detail::__plist_magic) + 2 * sizeof(uint32_t);
+        *this = mapped_plist(file, file->data() + header, file->data() + file->size());
+    }
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+
+    // 直接索引访问，支持负数索引。第一次访问时构造pcell
+    const pcell &operator[](std::ptrdiff_t i) const {
+        size_t k = index_trans(i);
+        if (cells.empty())
+            cells.resize(len), built.resize(len);
+        if (!built[k]) {
+            cells[k] = element(k).read_cell();
+            built[k] = true;
+        }
+        return cells[k];
+    }
+    // 直接从文件中读取算术类型的元素，类型不符时抛出bad_pcell_cast
+    template<typename T>
+    T get(std::ptrdiff_t i) const {
+        static_assert(std::is_arithmetic<T>::value, "get requires an arithmetic type");
+        auto ar = element(index_trans(i));
+        auto id = ar.read_pod<uint32_t>();
+        if (id != detail::__type_registry::instance().by_type(typeid(T)).id)
+            throw bad_pcell_cast(stored_type(id), typeid(T));
+        return ar.read_pod<T>();
+    }
+    // 字符串元素在文件中的位置和长度，不拷贝字符（字符串不以'\0'结尾）
+    std::pair<const char *, size_t> string_at(std::ptrdiff_t i) const {
+        size_t k = index_trans(i);
+        uint64_t b, e;
+        bounds(k, b, e);
+        iarchive ar(first + b, first + e);
+        auto id = ar.read_pod<uint32_t>();
+        if (id != detail::__type_registry::string_id)
+            throw bad_pcell_cast(stored_type(id), typeid(std::string));
+        auto n = ar.read_pod<uint64_t>();
+        ar.skip(n);
+        return {first + b + sizeof(uint32_t) + sizeof(uint64_t), n};
+    }
+    // 嵌套的列表，同样按需加载
+    mapped_plist sub(std::ptrdiff_t i) const {
+        size_t k = index_trans(i);
+        uint64_t b, e;
+        bounds(k, b, e);
+        iarchive ar(first + b, first + e);
+        auto id = ar.read_pod<uint32_t>();
+        if (id != detail::__type_registry::plist_id)
+            throw bad_pcell_cast(stored_type(id), typeid(plist));
+        return mapped_plist(file, first + b + sizeof(uint32_t), first + e);
+    }
+
+    // 构造出完整的plist
+    plist to_plist() const {
+        plist res;
+        res.reserve(len);
+        for (size_t i = 0; i < len; ++i)
+            res.push_back((*this)[i]);
+        return res;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const mapped_plist &ml) {
+        return os << ml.to_plist();
+    }
+};
+
+}
+
+#endif //__CRZ_PLIST_IO_HH__
@@ -0,0 +1,339 @@
+#ifndef __CRZ_PLIST_OF_HH__
+#define __CRZ_PLIST_OF_HH__
+
+#include "plist.hh"
+
+namespace crz {
+
+namespace detail {
+
+// 利用GCC/Clang的向量扩展实现的归约，编译器会将其翻译为目标平台的SIMD指令（没有SIMD指令时退化为标量运算）。
+// 每个向量16字节（SSE2/NEON的宽度），多个累加器交替使用以隐藏指令延迟，最后不足一组的元素逐个处理
+template<typename T, bool = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>
+struct __simd {
+    static constexpr size_t lanes = 16 / sizeof(T);
+    typedef T vec __attribute__((vector_size(16)));
+
+    static void load(vec &v, const T *p) {
+        std::memcpy(&v, p, sizeof(v));
+    }
+    static T min(const T &a, const T &b) { return b < a ? b : a; }
+    static T max(const T &a, const T &b) { return a < b ? b : a; }
+
+    static T sum(const T *p, size_t n) {
+        vec a0 = {}, a1 = {}, a2 = {}, a3 = {}, v;
+        size_t i = 0;
+        for (; i + 4 * lanes <= n; i += 4 * lanes) {
+            load(v, p + i), a0 += v;
+            load(v, p + i + lanes), a1 += v;
+            load(v, p + i + 2 * lanes), a2 += v;
+            load(v, p + i + 3 * lanes), a3 += v;
+        }
+        a0 += a1, a2 += a3, a0 += a2;
+        T res = 0;
+        for (size_t k = 0; k < lanes; ++k)
+            res += a0[k];
+        for (const T *q = p + i, *stop = p + n; q != stop; ++q)
+            res += *q;
+        return res;
+    }
+    // 要求n > 0
+    static T min(const T *p, size_t n) {
+        if (n < 2 * lanes)
+            return *std::min_element(p, p + n);
+        vec a0, a1, v;
+        load(a0, p), a1 = a0;
+        size_t i = 0;
+        for (; i + 2 * lanes <= n; i += 2 * lanes) {
+            load(v, p + i), a0 = v < a0 ? v : a0;
+            load(v, p + i + lanes), a1 = v < a1 ? v : a1;
+        }
+        a0 = a1 < a0 ? a1 : a0;
+        T res = a0[0];
+        for (size_t k = 1; k < lanes; ++k)
+            res = min(res, a0[k]);
+        for (const T *q = p + i, *stop = p + n; q != stop; ++q)
+            res = min(res, *q);
+        return res;
+    }
+    static T max(const T *p, size_t n) {
+        if (n < 2 * lanes)
+            return *std::max_element(p, p + n);
+        vec a0, a1, v;
+        load(a0, p), a1 = a0;
+        size_t i = 0;
+        for (; i + 2 * lanes <= n; i += 2 * lanes) {
+            load(v, p + i), a0 = a0 < v ? v : a0;
+            load(v, p + i + lanes), a1 = a1 < v ? v : a1;
+        }
+        a0 = a0 < a1 ? a1 : a0;
+        T res = a0[0];
+        for (size_t k = 1; k < lanes; ++k)
+            res = max(res, a0[k]);
+        for (const T *q = p + i, *stop = p + n; q != stop; ++q)
+            res = max(res, *q);
+        return res;
+    }
+    static size_t count(const T *p, size_t n, const T &x) {
+        size_t res = 0;
+        for (size_t i = 0; i < n; ++i)
+            res += p[i] == x;
+        return res;
+    }
+    // 转换为double再累加，整数求平均值时不会在T中溢出。每个向量放2个double
+    static double sum_double(const T *p, size_t n) {
+        typedef double dvec __attribute__((vector_size(16)));
+        dvec a0 = {}, a1 = {}, a2 = {}, a3 = {};
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            a0 += dvec{double(p[i]), double(p[i + 1])};
+            a1 += dvec{double(p[i + 2]), double(p[i + 3])};
+            a2 += dvec{double(p[i + 4]), double(p[i + 5])};
+            a3 += dvec{double(p[i + 6]), double(p[i + 7])};
+        }
+        a0 += a1, a2 += a3, a0 += a2;
+        double res = a0[0] + a0[1];
+        for (const T *q = p + i, *stop = p + n; q != stop; ++q)
+            res += static_cast<double>(*q);
+        return res;
+    }
+};
+
+// 非算术类型逐个处理
+template<typename T>
+struct __simd<T, false> {
+    static T sum(const T *p, size_t n) {
+        T res{};
+        for (size_t i = 0; i < n; ++i)
+            res = res + p[i];
+        return res;
+    }
+    static T min(const T *p, size_t n) {
+        return *std::min_element(p, p + n);
+    }
+    static T max(const T *p, size_t n) {
+        return *std::max_element(p, p + n);
+    }
+    static size_t count(const T *p, size_t n, const T &x) {
+        return std::count(p, p + n, x);
+    }
+    static double sum_double(const T *p, size_t n) {
+        return static_cast<double>(sum(p, n));
+    }
+};
+
+}
+
+// 按列存储的列表：元素的类型都为T时，直接存放在连续的std::vector<T>中，不需要逐个装进pcell，
+// 归约操作可以用SIMD指令完成。第一次放入其他类型的元素时，整个列表转换为通用的plist存储，之后保持该形式。
+// 只提供plist接口中的一部分：索引和切片读取、append、extend、pop_back、count、index、remove、reverse、sort，
+// 以及归约操作；元素以pcell的形式进出，修改元素使用set。需要其他操作时用to_plist转换
+template<typename T>
+class plist_of {
+    std::vector<T> col;
+    plist box;
+    bool boxed_{false};
+
+    size_t index_trans(std::ptrdiff_t i) const {
+        return detail::__index_trans(i, size());
+    }
+
+    // 转换为通用的plist存储
+    void to_boxed() {
+        if (boxed_)
+            return;
+        box.reserve(col.size());
+        for (auto &x: col)
+            box.emplace_back(std::move(x));
+        col.clear();
+        col.shrink_to_fit();
+        boxed_ = true;
+    }
+
+    static void empty_error(const char *name) {
+        throw std::invalid_argument(std::string(name) + "() arg is an empty sequence");
+    }
+
+    // 通用存储时求平均值用的和：算术类型逐个转换为double再累加，其他类型先求和再转换
+    double boxed_sum(std::true_type) const {
+        double res = 0;
+        for (const auto &x: box)
+            res += static_cast<double>(x.cast<const T &>());
+        return res;
+    }
+    double boxed_sum(std::false_type) const {
+        return static_cast<double>(sum());
+    }
+
+public:
+    plist_of() = default;
+    plist_of(std::initializer_list<T> il) : col(il) {}
+    template<typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    plist_of(It first, It last) : col(first, last) {}
+    // 由plist构造，元素都为T时按列存储，否则保持通用的存储
+    explicit plist_of(const plist &pl) {
+        for (const auto &x: pl) {
+            if (!x.isa<T>()) {
+                box = pl, boxed_ = true;
+                return;
+            }
+        }
+        col.reserve(pl.size());
+        for (const auto &x: pl)
+            col.push_back(x.cast<const T &>());
+    }
+
+    // 是否已经转换为通用的存储
+    bool boxed() const { return boxed_; }
+    // 按列存储时的元素，已经转换为通用存储时为空
+    const std::vector<T> &values() const { return col; }
+
+    size_t size() const { return boxed_ ? box.size() : col.size(); }
+    bool empty() const { return size() == 0; }
+    void reserve(size_t n) { boxed_ ? box.reserve(n) : col.reserve(n); }
+    void clear() { col.clear(), box.clear(), boxed_ = false; }
+
+    // 直接索引访问，支持负数索引。返回元素的拷贝，不能通过它修改列表（l[i] = x不能编译），修改元素使用set
+    const pcell operator[](std::ptrdiff_t i) const {
+        size_t k = index_trans(i);
+        return boxed_ ? box.std::vector<pcell>::operator[](k) : pcell(col[k]);
+    }
+    // 修改元素，类型不为T时转换为通用的存储
+    void set(std::ptrdiff_t i, const pcell &pc) {
+        size_t k = index_trans(i);
+        if (!boxed_ && pc.isa<T>())
+            col[k] = pc.cast<const T &>();
+        else
+            to_boxed(), box.std::vector<pcell>::operator[](k) = pc;
+    }
+    // 切片索引访问，返回一个新的plist_of
+    plist_of operator[](pslice sl) const {
+        plist_of res;
+        std::ptrdiff_t start, len = sl.indices(size(), start), step = sl.step();
+        if (boxed_) {
+            res.box = box[sl], res.boxed_ = true;
+            return res;
+        }
+        res.col.reserve(len);
+        for (std::ptrdiff_t i = 0; i < len; ++i)
+            res.col.push_back(col[start + i * step]);
+        return res;
+    }
+
+    // python API
+    void append(const T &t) {
+        boxed_ ? box.append(t) : col.push_back(t);
+    }
+    void append(T &&t) {
+        boxed_ ? box.append(std::move(t)) : col.push_back(std::move(t));
+    }
+    void append(const pcell &pc) {
+        if (!boxed_ && pc.isa<T>())
+            col.push_back(pc.cast<const T &>());
+        else
+            to_boxed(), box.append(pc);
+    }
+    void extend(const plist &pl) {
+        for (const auto &x: pl)
+            append(x);
+    }
+    void pop_back() {
+        boxed_ ? box.pop_back() : col.pop_back();
+    }
+    size_t count(const pcell &pc) const {
+        if (boxed_)
+            return box.count(pc);
+        return pc.isa<T>() ? detail::__simd<T>::count(col.data(), col.size(), pc.cast<const T &>()) : 0;
+    }
+    std::ptrdiff_t index(const pcell &pc) const {
+        if (boxed_)
+            return box.index(pc);
+        if (!pc.isa<T>())
+            return -1;
+        auto it = std::find(col.begin(), col.end(), pc.cast<const T &>());
+        return it == col.end() ? -1 : it - col.begin();
+    }
+    void remove(const pcell &pc) {
+        if (boxed_)
+            box.remove(pc);
+        else if (pc.isa<T>())
+            col.erase(std::remove(col.begin(), col.end(), pc.cast<T>()), col.end());
+    }
+    void reverse() {
+        boxed_ ? box.reverse() : std::reverse(col.begin(), col.end());
+    }
+    plist_of &sort(bool rvs = false) {
+        if (boxed_)
+            box.sort(rvs);
+        else if (!rvs)
+            std::stable_sort(col.begin(), col.end());
+        else
+            std::stable_sort(col.begin(), col.end(), [](const T &a, const T &b) { return b < a; });
+        return *this;
+    }
+
+    // 归约操作。按列存储时用SIMD指令完成；已经转换为通用存储时逐个转换为T，遇到其他类型的元素抛出bad_pcell_cast。
+    // 浮点数求和时各条SIMD通道分别累加，结果可能和顺序累加有舍入误差上的差别
+    T sum() const {
+        if (!boxed_)
+            return detail::__simd<T>::sum(col.data(), col.size());
+        T res{};
+        for (const auto &x: box)
+            res = res + x.cast<const T &>();
+        return res;
+    }
+    T min() const {
+        if (empty())
+            empty_error("min");
+        if (!boxed_)
+            return detail::__simd<T>::min(col.data(), col.size());
+        return std::min_element(box.begin(), box.end(), [](const pcell &a, const pcell &b) {
+            return a.cast<const T &>() < b.cast<const T &>();
+        })->template cast<T>();
+    }
+    T max() const {
+        if (empty())
+            empty_error("max");
+        if (!boxed_)
+            return detail::__simd<T>::max(col.data(), col.size());
+        return std::max_element(box.begin(), box.end(), [](const pcell &a, const pcell &b) {
+            return a.cast<const T &>() < b.cast<const T &>();
+        })->template cast<T>();
+    }
+    // 平均值在double中累加，整数的和超出T的范围时也不会溢出
+    double mean() const {
+        if (empty())
+            empty_error("mean");
+        if (!boxed_)
+            return detail::__simd<T>::sum_double(col.data(), col.size()) / size();
+        return boxed_sum(std::is_arithmetic<T>()) / size();
+    }
+
+    // 转换为通用的plist
+    plist to_plist() const {
+        if (boxed_)
+            return box;
+        plist res;
+        res.reserve(col.size());
+        for (const auto &x: col)
+            res.emplace_back(x);
+        return res;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const plist_of &pl) {
+        if (pl.boxed_)
+            return os << pl.box;
+        if (pl.col.empty())
+            return os << "[]";
+        os << '[';
+        auto it = pl.col.begin(), stop = pl.col.end();
+        detail::__default_print<T>::print_with_default(os, *it++, typeid(T).name());
+        for (; it != stop; ++it)
+            detail::__default_print<T>::print_with_default(os << ", ", *it, typeid(T).name());
+        return os << ']';
+    }
+};
+
+}
+
+#endif //__CRZ_PLIST_OF_HH__
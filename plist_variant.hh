@@ -0,0 +1,887 @@
+#ifndef __CRZ_PLIST_VARIANT_HH__
+#define __CRZ_PLIST_VARIANT_HH__
+
+#include "plist.hh"
+
+namespace crz {
+
+namespace detail {
+
+// 类型T在Ts中的下标，不在其中时为sizeof...(Ts)
+template<typename T, typename ...Ts>
+struct __index_of : std::integral_constant<size_t, 0> {};
+template<typename T, typename ...Ts>
+struct __index_of<T, T, Ts...> : std::integral_constant<size_t, 0> {};
+template<typename T, typename U, typename ...Ts>
+struct __index_of<T, U, Ts...> : std::integral_constant<size_t, 1 + __index_of<T, Ts...>::value> {};
+
+template<size_t ...Ns>
+struct __max_of : std::integral_constant<size_t, 0> {};
+template<size_t N, size_t ...Ns>
+struct __max_of<N, Ns...> : std::integral_constant<size_t, (N > __max_of<Ns...>::value ? N : __max_of<Ns...>::value)> {};
+
+template<bool ...Bs>
+struct __all_of : std::true_type {};
+template<bool B, bool ...Bs>
+struct __all_of<B, Bs...> : std::integral_constant<bool, B && __all_of<Bs...>::value> {};
+
+// 按下标分派：找到下标为i的类型T后调用f.template apply<T>()。
+// 递归全部内联后是对常量下标的一串比较，编译器会将其生成为switch，不经过函数指针
+template<typename F>
+inline bool __visit(__type_list<>, size_t, F &) {
+    return false;
+}
+template<typename F, typename T, typename ...Ts>
+inline bool __visit(__type_list<T, Ts...>, size_t i, F &f) {
+    if (i != 0)
+        return __visit(__type_list<Ts...>(), i - 1, f);
+    f.template apply<T>();
+    return true;
+}
+
+// Ts中第一个满足条件P的类型的下标，都不满足时为sizeof...(Ts)
+template<template<typename> class P, typename ...Ts>
+struct __find_if : std::integral_constant<size_t, 0> {};
+template<template<typename> class P, typename T, typename ...Ts>
+struct __find_if<P, T, Ts...> : std::integral_constant<size_t, P<T>::value ? 0 : 1 + __find_if<P, Ts...>::value> {};
+
+template<size_t I, typename ...Ts>
+struct __type_at {
+    using type = void;
+};
+template<typename T, typename ...Ts>
+struct __type_at<0, T, Ts...> {
+    using type = T;
+};
+template<size_t I, typename T, typename ...Ts>
+struct __type_at<I, T, Ts...> : __type_at<I - 1, Ts...> {};
+
+template<typename T>
+using __is_c_string = std::integral_constant<bool,
+        std::is_same<T, const char *>::value || std::is_same<T, char *>::value>;
+template<typename T>
+using __is_std_string = std::is_same<T, std::string>;
+template<typename T>
+using __is_integer = std::integral_constant<bool,
+        std::is_integral<T>::value && !std::is_same<T, bool>::value && !__is_char<T>::value>;
+
+// 放入variant_cell时实际存放的类型：B在类型列表中时不变；否则字符串字面量放入std::string，
+// 整数放入列表中的第一个整数类型，浮点数放入第一个浮点数类型（例如1可以直接放入long long）。
+// 都不满足时为void，不能放入
+template<typename B, typename ...Ts>
+struct __variant_store {
+    template<template<typename> class P>
+    using first = typename __type_at<__find_if<P, Ts...>::value, Ts...>::type;
+    using type = typename std::conditional<
+            __index_of<B, Ts...>::value != sizeof...(Ts), B,
+            typename std::conditional<__is_c_string<B>::value, first<__is_std_string>,
+                    typename std::conditional<__is_integer<B>::value, first<__is_integer>,
+                            typename std::conditional<std::is_floating_point<B>::value, first<std::is_floating_point>,
+                                    void>::type>::type>::type>::type;
+};
+
+}
+
+template<typename ...Ts>
+class plist_variant;
+
+// 只能存放Ts中的类型的容器，内部为类型下标加上足以放下其中任何类型的缓冲区，不使用堆内存。
+// 输出、比较、哈希等操作按下标分派到具体类型，可以内联，不经过操作表，也不使用RTTI（只在抛出异常时使用类型名）。
+// 和pcell一样可以为空，空值输出为None
+template<typename ...Ts>
+class variant_cell {
+    static_assert(sizeof...(Ts) > 0 && sizeof...(Ts) < 255, "variant_cell needs 1 to 254 types");
+    static_assert(detail::__all_of<(std::is_same<Ts, typename std::decay<Ts>::type>::value)...>::value,
+                  "variant_cell can only hold non-reference, non-const object types");
+
+    using types = detail::__type_list<Ts...>;
+    static constexpr unsigned char none = sizeof...(Ts);
+
+    typename std::aligned_storage<detail::__max_of<sizeof(Ts)...>::value,
+            detail::__max_of<alignof(Ts)...>::value>::type buf;
+    unsigned char tag_{none};
+
+    template<typename T>
+    using base_type = typename std::decay<T>::type;
+    template<typename T>
+    using store_type = typename detail::__variant_store<base_type<T>, Ts...>::type;
+    template<typename T>
+    using index_of = detail::__index_of<T, Ts...>;
+
+    template<typename T>
+    T *ptr() noexcept {
+        return reinterpret_cast<T *>(&buf);
+    }
+    template<typename T>
+    const T *ptr() const noexcept {
+        return reinterpret_cast<const T *>(&buf);
+    }
+
+    // 以下是按类型分派的各个操作
+    struct copier {
+        const variant_cell &src;
+        variant_cell &dst;
+        template<typename T>
+        void apply() { ::new(static_cast<void *>(&dst.buf)) T(*src.ptr<T>()); }
+    };
+    struct mover {
+        variant_cell &src;
+        variant_cell &dst;
+        template<typename T>
+        void apply() { ::new(static_cast<void *>(&dst.buf)) T(std::move(*src.ptr<T>())); }
+    };
+    struct destroyer {
+        variant_cell &c;
+        template<typename T>
+        void apply() { c.ptr<T>()->~T(); }
+    };
+    struct printer {
+        std::ostream &os;
+        const variant_cell &c;
+        template<typename T>
+        void apply() { detail::__default_print<T>::print_with_default(os, *c.ptr<T>(), typeid(T).name()); }
+    };
+    struct writer {
+        pbuffer &buf;
+        const variant_cell &c;
+        template<typename T>
+        void apply() { detail::__buffer_print<T>::write(buf, *c.ptr<T>()); }
+    };
+    struct equal_op {
+        const variant_cell &a, &b;
+        bool res;
+        template<typename T>
+        void apply() { res = detail::__default_equal<T>::compare(*a.ptr<T>(), *b.ptr<T>()); }
+    };
+    struct less_op {
+        const variant_cell &a, &b;
+        bool res;
+        template<typename T>
+        void apply() { res = detail::__default_less<T>::compare(*a.ptr<T>(), *b.ptr<T>()); }
+    };
+    struct compare_op {
+        const variant_cell &a, &b;
+        ordering res;
+        template<typename T>
+        void apply() { res = detail::__default_compare<T>::compare(*a.ptr<T>(), *b.ptr<T>()); }
+    };
+    struct number_op {
+        const variant_cell &c;
+        bool arithmetic;
+        long double res;
+        template<typename T>
+        void apply() { to_number(std::is_arithmetic<T>(), *c.ptr<T>()); }
+        template<typename T>
+        void to_number(std::true_type, const T &t) { arithmetic = true, res = static_cast<long double>(t); }
+        template<typename T>
+        void to_number(std::false_type, const T &) { arithmetic = false; }
+    };
+    struct hash_op {
+        const variant_cell &c;
+        size_t res;
+        template<typename T>
+        void apply() { res = detail::__default_hash<T>::hash(*c.ptr<T>()); }
+    };
+    struct type_op {
+        const std::type_info *res;
+        template<typename T>
+        void apply() { res = &typeid(T); }
+    };
+    struct pcell_op {
+        const variant_cell &c;
+        pcell res;
+        template<typename T>
+        void apply() { res = *c.ptr<T>(); }
+    };
+
+    // 从pcell构造：依次尝试类型列表中的每个类型，P为右值时移动其中的对象。
+    // 都不是时按__variant_store的规则转换，例如int放入long long，const char *放入std::string
+    using promotable = detail::__type_list<const char *, char *, int, long, long long, unsigned, unsigned long,
+            unsigned long long, short, unsigned short, double, float, long double>;
+    template<typename P>
+    void assign_from(P &&pc, detail::__type_list<>) {
+        promote_from(pc, promotable());
+    }
+    template<typename P, typename T, typename ...Rest>
+    void assign_from(P &&pc, detail::__type_list<T, Rest...>) {
+        if (auto *p = pc.template try_cast<T>()) {
+            using arg = typename std::conditional<std::is_lvalue_reference<P>::value, const T &, T &&>::type;
+            emplace<T>(static_cast<arg>(*p));
+            return;
+        }
+        assign_from(std::forward<P>(pc), detail::__type_list<Rest...>());
+    }
+    void promote_from(const pcell &pc, detail::__type_list<>) {
+        throw bad_pcell_cast(pc.type(), typeid(variant_cell));
+    }
+    template<typename T, typename ...Rest>
+    void promote_from(const pcell &pc, detail::__type_list<T, Rest...>) {
+        if (!promote<T>(pc, std::integral_constant<bool, index_of<store_type<T>>::value != sizeof...(Ts)>()))
+            promote_from(pc, detail::__type_list<Rest...>());
+    }
+    template<typename T>
+    bool promote(const pcell &, std::false_type) { return false; }
+    template<typename T>
+    bool promote(const pcell &pc, std::true_type) {
+        if (auto *p = pc.template try_cast<T>()) {
+            emplace<store_type<T>>(*p);
+            return true;
+        }
+        return false;
+    }
+
+    static bool less(const variant_cell &a, const variant_cell &b, const char *opt) {
+        if (a.tag_ != b.tag_ || !a.has_value())
+            throw bad_comparison(a.type(), b.type(), opt);
+        less_op f{a, b, false};
+        detail::__visit(types(), a.tag_, f);
+        return f.res;
+    }
+
+    template<typename T>
+    T *get_value() {
+        static_assert(index_of<T>::value != sizeof...(Ts), "the type is not in the type list of variant_cell");
+        if (tag_ != index_of<T>::value)
+            throw bad_pcell_cast(type(), typeid(T));
+        return ptr<T>();
+    }
+    template<typename T>
+    const T *get_value() const {
+        return const_cast<variant_cell *>(this)->get_value<T>();
+    }
+
+    template<typename ...>
+    friend class plist_variant;
+
+public:
+    variant_cell() = default;
+    // 隐式构造函数，T必须能放入类型列表中的某个类型，规则见__variant_store
+    template<typename T, typename S = store_type<T>,
+            typename = typename std::enable_if<
+                    !std::is_same<base_type<T>, variant_cell>::value && index_of<S>::value != sizeof...(Ts)>::type>
+    variant_cell(T &&t) {
+        ::new(static_cast<void *>(&buf)) S(std::forward<T>(t));
+        tag_ = index_of<S>::value;
+    }
+    // 原位构造T的对象
+    template<typename T, typename ...Args>
+    explicit variant_cell(in_place_type_t<T>, Args &&...args) {
+        emplace<T>(std::forward<Args>(args)...);
+    }
+    // 由pcell构造，对象的类型不在类型列表中、也不能按隐式构造函数的规则转换时抛出bad_pcell_cast，空的pcell得到空值
+    explicit variant_cell(const pcell &pc) {
+        if (pc.has_value())
+            assign_from(pc, types());
+    }
+    explicit variant_cell(pcell &&pc) {
+        if (pc.has_value())
+            assign_from(std::move(pc), types());
+    }
+    variant_cell(const variant_cell &rhs) {
+        copier f{rhs, *this};
+        if (detail::__visit(types(), rhs.tag_, f))
+            tag_ = rhs.tag_;
+    }
+    variant_cell(variant_cell &&rhs) noexcept(detail::__all_of<std::is_nothrow_move_constructible<Ts>::value...>::value) {
+        mover f{rhs, *this};
+        if (detail::__visit(types(), rhs.tag_, f))
+            tag_ = rhs.tag_;
+    }
+    ~variant_cell() { reset(); }
+
+    // 先拷贝再移动过来，拷贝抛出异常时保持不变
+    variant_cell &operator=(const variant_cell &rhs) {
+        if (this != &rhs) {
+            variant_cell tmp(rhs);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+    // 移动构造抛出异常时容器为空
+    variant_cell &operator=(variant_cell &&rhs) noexcept(
+            detail::__all_of<std::is_nothrow_move_constructible<Ts>::value...>::value) {
+        if (this != &rhs) {
+            reset();
+            mover f{rhs, *this};
+            if (detail::__visit(types(), rhs.tag_, f))
+                tag_ = rhs.tag_;
+        }
+        return *this;
+    }
+    template<typename T, typename S = store_type<T>,
+            typename = typename std::enable_if<
+                    !std::is_same<base_type<T>, variant_cell>::value && index_of<S>::value != sizeof...(Ts)>::type>
+    variant_cell &operator=(T &&t) {
+        emplace<S>(std::forward<T>(t));
+        return *this;
+    }
+
+    // 销毁原有的对象，再用args原位构造T的对象，返回其引用。构造时抛出异常则容器为空
+    template<typename T, typename ...Args>
+    T &emplace(Args &&...args) {
+        static_assert(index_of<T>::value != sizeof...(Ts), "the type is not in the type list of variant_cell");
+        reset();
+        ::new(static_cast<void *>(&buf)) T(std::forward<Args>(args)...);
+        tag_ = index_of<T>::value;
+        return *ptr<T>();
+    }
+
+    void reset() noexcept {
+        destroyer f{*this};
+        detail::__visit(types(), tag_, f);
+        tag_ = none;
+    }
+
+    bool has_value() const noexcept {
+        return tag_ != none;
+    }
+    // 对象的类型在类型列表中的下标，空值为sizeof...(Ts)
+    size_t index() const noexcept {
+        return tag_;
+    }
+    // 对象类型的type_info，空值为typeid(void)。只用于输出错误信息，其他操作不依赖它
+    const std::type_info &type() const noexcept {
+        type_op f{&typeid(void)};
+        detail::__visit(types(), tag_, f);
+        return *f.res;
+    }
+    template<typename T>
+    bool isa() const noexcept {
+        return tag_ == index_of<base_type<T>>::value;
+    }
+    template<typename T, typename B = base_type<T>>
+    B *try_cast() noexcept {
+        return isa<B>() ? ptr<B>() : nullptr;
+    }
+    template<typename T, typename B = base_type<T>>
+    const B *try_cast() const noexcept {
+        return isa<B>() ? ptr<B>() : nullptr;
+    }
+    // 返回容器内的对象的值，类型不符时抛出bad_pcell_cast。目标的底层类型为variant_cell时返回自身
+    template<typename T, typename B = base_type<T>, typename = void,
+            typename = typename std::enable_if<!std::is_same<B, variant_cell>::value>::type>
+    T cast() {
+        return *get_value<B>();
+    }
+    template<typename T, typename B = base_type<T>, typename = void,
+            typename = typename std::enable_if<
+                    !std::is_same<B, variant_cell>::value &&
+                    (!std::is_reference<T>::value || std::is_const<typename std::remove_reference<T>::type>::value)
+            >::type>
+    T cast() const {
+        return *get_value<B>();
+    }
+    template<typename T, typename B = base_type<T>,
+            typename = typename std::enable_if<std::is_same<B, variant_cell>::value>::type>
+    T cast() {
+        return *this;
+    }
+    template<typename T, typename B = base_type<T>,
+            typename = typename std::enable_if<
+                    std::is_same<B, variant_cell>::value &&
+                    (!std::is_reference<T>::value || std::is_const<typename std::remove_reference<T>::type>::value)
+            >::type>
+    T cast() const {
+        return *this;
+    }
+
+    // 转换为pcell
+    pcell to_pcell() const {
+        pcell_op f{*this, pcell()};
+        detail::__visit(types(), tag_, f);
+        return std::move(f.res);
+    }
+
+    // 哈希值和pcell的一致，空值为0。类型没有特化std::hash时抛出bad_pcell_hash
+    size_t hash() const {
+        hash_op f{*this, 0};
+        detail::__visit(types(), tag_, f);
+        return f.res;
+    }
+    // 三路比较，规则和pcell::compare相同
+    ordering compare(const variant_cell &rhs) const {
+        if (!has_value() || !rhs.has_value())
+            return has_value() == rhs.has_value() ? ordering::equal : ordering::incomparable;
+        if (tag_ == rhs.tag_) {
+            compare_op f{*this, rhs, ordering::incomparable};
+            detail::__visit(types(), tag_, f);
+            return f.res;
+        }
+        number_op x{*this, false, 0}, y{rhs, false, 0};
+        detail::__visit(types(), tag_, x), detail::__visit(types(), rhs.tag_, y);
+        if (!x.arithmetic || !y.arithmetic)
+            return ordering::incomparable;
+        return x.res < y.res ? ordering::less : y.res < x.res ? ordering::greater
+                                                              : x.res == y.res ? ordering::equal : ordering::incomparable;
+    }
+
+    void write_to(pbuffer &b) const {
+        writer f{b, *this};
+        if (!detail::__visit(types(), tag_, f))
+            b.append("None", 4);
+    }
+    friend std::ostream &operator<<(std::ostream &os, const variant_cell &c) {
+        printer f{os, c};
+        return detail::__visit(types(), c.tag_, f) ? os : (os << "None");
+    }
+
+    // 比较运算的规则和pcell相同：类型不同时不相等，<等运算抛出bad_comparison
+    friend bool operator==(const variant_cell &a, const variant_cell &b) {
+        if (a.tag_ != b.tag_)
+            return false;
+        equal_op f{a, b, true};
+        detail::__visit(types(), a.tag_, f);
+        return f.res;
+    }
+    friend bool operator!=(const variant_cell &a, const variant_cell &b) {
+        return !(a == b);
+    }
+    friend bool operator<(const variant_cell &a, const variant_cell &b) {
+        return less(a, b, "<");
+    }
+    friend bool operator>(const variant_cell &a, const variant_cell &b) {
+        return less(b, a, ">");
+    }
+    friend bool operator<=(const variant_cell &a, const variant_cell &b) {
+        return a < b || a == b;
+    }
+    friend bool operator>=(const variant_cell &a, const variant_cell &b) {
+        return a > b || a == b;
+    }
+};
+
+// 元素类型限定在Ts中的列表，元素为variant_cell<Ts...>，直接存放在std::vector中，不使用堆内存，
+// 元素的输出、比较、哈希按类型下标分派，不经过pcell的操作表。接口和plist保持一致，可以和plist相互转换。
+// 和plist不同，切片返回新的列表而不是视图，map的结果也必须是Ts中的类型
+template<typename ...Ts>
+class plist_variant : public std::vector<variant_cell<Ts...>> {
+public:
+    using cell_type = variant_cell<Ts...>;
+
+private:
+    using base_vector = std::vector<cell_type>;
+    using types = detail::__type_list<Ts...>;
+
+    template<typename F>
+    using first_arg_type = typename ft::function_traits<F>::template argument_type<0>;
+
+    base_vector &base() noexcept {
+        return *this;
+    }
+    const base_vector &base() const noexcept {
+        return *this;
+    }
+
+    size_t index_trans(std::ptrdiff_t i) const {
+        return detail::__index_trans(i, this->size());
+    }
+    size_t insert_pos(std::ptrdiff_t i) const {
+        return detail::__insert_pos(i, this->size());
+    }
+
+    // 原地重排元素：重排后第i个位置放置原来的第order[i]个元素。会修改order
+    void permute(std::vector<size_t> &order) {
+        auto &v = base();
+        for (size_t i = 0, len = order.size(); i < len; ++i) {
+            if (order[i] == i)
+                continue;
+            cell_type tmp(std::move(v[i]));
+            size_t j = i;
+            while (order[j] != i) {
+                size_t next = order[j];
+                v[j] = std::move(v[next]);
+                order[j] = j, j = next;
+            }
+            v[j] = std::move(tmp);
+            order[j] = j;
+        }
+    }
+
+    // 所有元素的类型相同时返回其下标，否则（包括空列表）返回sizeof...(Ts)
+    size_t common_index() const noexcept {
+        if (this->empty())
+            return sizeof...(Ts);
+        size_t tag = this->front().tag_;
+        for (const auto &x: *this) {
+            if (x.tag_ != tag)
+                return sizeof...(Ts);
+        }
+        return tag;
+    }
+
+    // 类型不同的元素必然不相等，只需在下标相同的元素中直接比较值
+    struct fast_count {
+        const plist_variant &pl;
+        const cell_type &c;
+        size_t res;
+        template<typename T>
+        void apply() {
+            const T &v = *c.template ptr<T>();
+            for (const auto &x: pl)
+                res += x.tag_ == c.tag_ && *x.template ptr<T>() == v;
+        }
+    };
+    struct fast_find {
+        const plist_variant &pl;
+        const cell_type &c;
+        typename base_vector::const_iterator res;
+        template<typename T>
+        void apply() {
+            const T &v = *c.template ptr<T>();
+            res = std::find_if(pl.begin(), pl.end(), [&](const cell_type &x) {
+                return x.tag_ == c.tag_ && *x.template ptr<T>() == v;
+            });
+        }
+    };
+    // 元素类型全部相同时只分派一次。算术类型和字符串的比较不会抛出异常，和plist::fast_sort一样将值取出到
+    // 连续的缓冲区中排序，再按顺序放回；相等的整数和字符串无法区分，可以用不稳定的排序。
+    // 其他类型（例如plist）的比较可能抛出异常，对下标稳定排序后再重排元素，抛出异常时列表保持不变。
+    // 类型不支持<时在移动任何元素之前抛出bad_comparison
+    struct fast_sort {
+        plist_variant &pl;
+        bool rvs;
+        template<typename T>
+        using by_value = std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_same<T, std::string>::value>;
+        template<typename T, typename C>
+        static void sort_values(std::vector<T> &vals, C cmp) {
+            if (std::is_floating_point<T>::value)
+                std::stable_sort(vals.begin(), vals.end(), cmp);
+            else
+                std::sort(vals.begin(), vals.end(), cmp);
+        }
+        template<typename T>
+        static bool less(const T &a, const T &b) {
+            return detail::__default_less<T>::compare(a, b);
+        }
+        template<typename T>
+        void apply() {
+            if (!detail::__has_less<T>::value)
+                throw bad_comparison(typeid(T), typeid(T), "<");
+            sort_as<T>(by_value<T>());
+        }
+        template<typename T>
+        void sort_as(std::true_type) {
+            std::vector<T> vals;
+            vals.reserve(pl.size());
+            for (auto &x: pl)
+                vals.push_back(std::move(*x.template ptr<T>()));
+            !rvs ? sort_values(vals, [](const T &a, const T &b) { return less(a, b); })
+                 : sort_values(vals, [](const T &a, const T &b) { return less(b, a); });
+            auto it = vals.begin();
+            for (auto &x: pl)
+                *x.template ptr<T>() = std::move(*it++);
+        }
+        template<typename T>
+        void sort_as(std::false_type) {
+            const base_vector &v = pl;
+            std::vector<size_t> order(v.size());
+            for (size_t i = 0, len = order.size(); i < len; ++i)
+                order[i] = i;
+            auto val = [&](size_t i) -> const T & { return *v[i].template ptr<T>(); };
+            !rvs
+            ? std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return less(val(a), val(b));
+            })
+            : std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return less(val(b), val(a));
+            });
+            pl.permute(order);
+        }
+    };
+    // 全序排序时可以直接使用快速路径的类型：值之间总能比较
+    struct ordered_check {
+        bool res;
+        template<typename T>
+        void apply() { res = std::is_integral<T>::value || std::is_same<T, std::string>::value; }
+    };
+
+    // 全序排序时每个元素的排序依据，事先计算一次
+    struct total_key {
+        int group; // 0为空值，1为算术类型，2为其他类型
+        bool ordered; // 能否和自身比较，NaN和不支持比较的对象不能
+        long double num;
+        const cell_type *cell;
+        const plist *list; // 元素为plist时指向它，和plist::sort(total_order)一样按全序逐个比较其中的元素
+        size_t pos;
+
+        // plist在类型列表中的下标，不在其中时为sizeof...(Ts)，和任何非空元素的下标都不相等
+        static constexpr size_t list_index = detail::__index_of<plist, Ts...>::value;
+
+        total_key(const cell_type &c, size_t i) : group(0), ordered(true), num(0), cell(&c), list(nullptr), pos(i) {
+            if (!c.has_value())
+                return;
+            typename cell_type::number_op f{c, false, 0};
+            detail::__visit(types(), c.tag_, f);
+            if (f.arithmetic)
+                group = 1, num = f.res, ordered = num == num;
+            else if (c.tag_ == list_index)
+                group = 2, list = c.template ptr<plist>();
+            else
+                group = 2, ordered = c.compare(c) != ordering::incomparable;
+        }
+
+        // 先按分组，其他类型再按在类型列表中的下标，能比较的元素在前，最后按值
+        bool before(const total_key &b) const {
+            if (group != b.group)
+                return group < b.group;
+            if (group == 2 && cell->tag_ != b.cell->tag_)
+                return cell->tag_ < b.cell->tag_;
+            if (ordered != b.ordered)
+                return ordered;
+            if (!ordered || group == 0)
+                return false;
+            if (group == 1)
+                return num < b.num;
+            return (list ? list->compare(*b.list, total_order) : cell->compare(*b.cell)) == ordering::less;
+        }
+    };
+
+public:
+    using base_vector::base_vector;
+    using base_vector::insert;
+    using base_vector::erase;
+
+    plist_variant() = default;
+    // 由plist构造，元素的类型不在类型列表中时抛出bad_pcell_cast
+    explicit plist_variant(const plist &pl) {
+        this->reserve(pl.size());
+        for (const auto &x: pl)
+            this->emplace_back(x);
+    }
+    explicit plist_variant(plist &&pl) {
+        this->reserve(pl.size());
+        for (auto &x: pl)
+            this->emplace_back(std::move(x));
+        pl.clear();
+    }
+    // 转换为通用的plist
+    plist to_plist() const {
+        plist res;
+        res.reserve(this->size());
+        for (const auto &x: *this)
+            res.push_back(x.to_pcell());
+        return res;
+    }
+
+    // 在列表末尾用args原位构造T的对象
+    template<typename T, typename ...Args>
+    cell_type &emplace_back(Args &&...args) {
+        base_vector::emplace_back(in_place_type_t<T>(), std::forward<Args>(args)...);
+        return this->back();
+    }
+    using base_vector::emplace_back;
+
+    // 直接索引访问，支持负数索引
+    cell_type &operator[](std::ptrdiff_t i) {
+        return base_vector::operator[](index_trans(i));
+    }
+    const cell_type &operator[](std::ptrdiff_t i) const {
+        return base_vector::operator[](index_trans(i));
+    }
+    // 切片索引访问，返回一个新的列表
+    plist_variant operator[](pslice sl) const {
+        std::ptrdiff_t start, len = sl.indices(this->size(), start), step = sl.step();
+        plist_variant res;
+        res.reserve(len);
+        for (std::ptrdiff_t i = 0; i < len; ++i)
+            res.push_back(base()[start + i * step]);
+        return res;
+    }
+
+    // 列表连接和拷贝
+    friend plist_variant operator+(plist_variant a, const plist_variant &b) {
+        a += b;
+        return a;
+    }
+    plist_variant &operator+=(const plist_variant &pl) {
+        size_t len = pl.size();
+        this->reserve(this->size() + len);
+        for (size_t i = 0; i < len; ++i) // pl可能就是自身，空间已经预留好，不会失效
+            this->push_back(pl.base()[i]);
+        return *this;
+    }
+    friend plist_variant operator*(const plist_variant &pl, size_t time) {
+        plist_variant res;
+        res.reserve(pl.size() * time);
+        for (size_t t = 0; t < time; ++t)
+            res.insert(res.end(), pl.begin(), pl.end());
+        return res;
+    }
+    friend plist_variant operator*(size_t time, const plist_variant &pl) {
+        return pl * time;
+    }
+
+    // 将列表的输出写入buf，格式和plist相同
+    void write_to(pbuffer &buf) const {
+        buf.append('[');
+        for (size_t i = 0, n = this->size(); i < n; ++i) {
+            if (i)
+                buf.append(", ", 2);
+            base()[i].write_to(buf);
+        }
+        buf.append(']');
+    }
+    friend std::ostream &operator<<(std::ostream &os, const plist_variant &pl) {
+        if (detail::__default_format(os)) {
+            detail::__buffer_lease lease;
+            pl.write_to(lease.get());
+            return os.write(lease.get().data(), lease.get().size());
+        }
+        os << '[';
+        for (size_t i = 0, n = pl.size(); i < n; ++i)
+            (i ? os << ", " : os) << pl.base()[i];
+        return os << ']';
+    }
+    explicit operator std::string() const {
+        detail::__buffer_lease lease;
+        write_to(lease.get());
+        return lease.get().str();
+    }
+
+    // python API
+    size_t count(const cell_type &c) const {
+        fast_count fc{*this, c, 0};
+        return detail::__visit(types(), c.tag_, fc) ? fc.res : std::count(this->begin(), this->end(), c);
+    }
+    std::ptrdiff_t index(const cell_type &c) const {
+        fast_find ff{*this, c, this->end()};
+        auto it = detail::__visit(types(), c.tag_, ff) ? ff.res : std::find(this->begin(), this->end(), c);
+        return it == this->end() ? -1 : it - this->begin();
+    }
+    void append(const cell_type &c) {
+        this->push_back(c);
+    }
+    void append(cell_type &&c) {
+        this->push_back(std::move(c));
+    }
+    // 在下标i之前插入，和python的l.insert(i, x)一样
+    void insert(std::ptrdiff_t i, const cell_type &c) {
+        insert(this->begin() + insert_pos(i), c);
+    }
+    void insert(std::ptrdiff_t i, cell_type &&c) {
+        insert(this->begin() + insert_pos(i), std::move(c));
+    }
+    void extend(const plist_variant &pl) {
+        *this += pl;
+    }
+    void remove(const cell_type &c) {
+        const cell_type v = c; // c可能就是列表中的元素
+        erase(std::remove(this->begin(), this->end(), v), this->end());
+    }
+    void reverse() {
+        std::reverse(this->begin(), this->end());
+    }
+
+    // 排序函数，直接比较元素，rvs代表是否逆序排序，排序是稳定的。
+    // 类型都相同时只分派一次，直接对值排序；类型不同时和plist一样抛出bad_comparison，列表保持不变
+    plist_variant &sort(bool rvs = false) {
+        if (this->size() < 2)
+            return *this;
+        fast_sort fs{*this, rvs};
+        if (detail::__visit(types(), common_index(), fs))
+            return *this;
+        const auto &v = base();
+        size_t i = 1, n = v.size();
+        while (i < n - 1 && v[i].tag_ == v[0].tag_)
+            ++i;
+        throw bad_comparison(v[0].type(), v[i].type(), "<");
+    }
+    // 排序函数。其中key是一个一元函数（类型为A => B），和plist::sort一样每个元素只计算一次key
+    template<typename F>
+    plist_variant &sort(bool rvs, F key) {
+        using arg_type = first_arg_type<F>;
+        using store = detail::__key_store<typename ft::function_traits<F>::result_type>;
+        using entry = std::pair<typename store::type, size_t>;
+        std::vector<entry> keys;
+        keys.reserve(this->size());
+        for (size_t i = 0, len = this->size(); i < len; ++i)
+            keys.emplace_back(store::make(key(base()[i].template cast<arg_type>())), i);
+        !rvs
+        ? std::stable_sort(keys.begin(), keys.end(),
+                           [](const entry &a, const entry &b) {
+                               return store::get(a.first) < store::get(b.first);
+                           })
+        : std::stable_sort(keys.begin(), keys.end(),
+                           [](const entry &a, const entry &b) {
+                               return store::get(b.first) < store::get(a.first);
+                           });
+        std::vector<size_t> order;
+        order.reserve(keys.size());
+        for (const auto &k: keys)
+            order.push_back(k.second);
+        keys.clear();
+        permute(order);
+        return *this;
+    }
+    // 全序排序，规则和plist::sort(total_order)相同，只是其他类型的元素按在类型列表中的下标分组，不比较类型名
+    plist_variant &sort(total_order_t, bool rvs = false) {
+        ordered_check oc{false};
+        detail::__visit(types(), common_index(), oc);
+        if (oc.res)
+            return sort(rvs);
+        const auto &v = base();
+        std::vector<total_key> keys;
+        keys.reserve(this->size());
+        for (size_t i = 0, len = this->size(); i < len; ++i)
+            keys.emplace_back(v[i], i);
+        !rvs
+        ? std::stable_sort(keys.begin(), keys.end(), [](const total_key &a, const total_key &b) {
+            return a.before(b);
+        })
+        : std::stable_sort(keys.begin(), keys.end(), [](const total_key &a, const total_key &b) {
+            return b.before(a);
+        });
+        std::vector<size_t> order;
+        order.reserve(keys.size());
+        for (const auto &k: keys)
+            order.push_back(k.pos);
+        keys.clear();
+        permute(order);
+        return *this;
+    }
+
+    // 其他常用的列表操作，函数的参数可以是Ts中的类型或者cell_type
+    template<typename F>
+    plist_variant &for_each(F trans) {
+        using arg_type = first_arg_type<F>;
+        for (auto &x: *this)
+            trans(x.template cast<arg_type>());
+        return *this;
+    }
+
+    template<typename F>
+    plist_variant map(F mapping) const {
+        using arg_type = first_arg_type<F>;
+        plist_variant res;
+        res.reserve(this->size());
+        for (const auto &x: *this)
+            res.push_back(mapping(x.template cast<arg_type>()));
+        return res;
+    }
+
+    template<typename F>
+    plist_variant filter(F pred) const {
+        using arg_type = first_arg_type<F>;
+        plist_variant res;
+        for (const auto &x: *this) {
+            if (pred(x.template cast<arg_type>()))
+                res.push_back(x);
+        }
+        return res;
+    }
+};
+
+}
+
+namespace std {
+
+template<typename ...Ts>
+struct hash<crz::variant_cell<Ts...>> {
+    size_t operator()(const crz::variant_cell<Ts...> &c) const {
+        return c.hash();
+    }
+};
+
+}
+
+#endif //__CRZ_PLIST_VARIANT_HH__
@@ -0,0 +1,205 @@
+#ifndef __CRZ_SORTED_PLIST_HH__
+#define __CRZ_SORTED_PLIST_HH__
+
+#include "plist.hh"
+
+namespace crz {
+
+// 始终保持有序的列表，和python的bisect模块一样用二分查找定位，元素之间用pcell的<比较。
+// 可以给定key函数（类型为A => B），每个元素只在放入时计算一次key，之后的比较都使用保存的key。
+// 批量插入时先对新元素排序，再在一遍线性的合并中放入列表，k个元素的代价为O(k log k + n)。
+// 排序是稳定的：key相等的元素保持放入的先后顺序。元素只能只读访问，以免破坏顺序
+class sorted_plist {
+    using key_func = std::function<pcell(const pcell &)>;
+
+    plist items_;
+    plist keys_;  // 有key函数时为每个元素的key，否则为空，直接比较元素
+    key_func key_;
+
+    template<typename F>
+    static key_func wrap(F f) {
+        using arg_type = typename ft::function_traits<F>::template argument_type<0>;
+        return [f](const pcell &x) -> pcell { return f(x.cast<arg_type>()); };
+    }
+
+    const plist &key_list() const {
+        return key_ ? keys_ : items_;
+    }
+    pcell key_of(const pcell &x) const {
+        return key_ ? key_(x) : x;
+    }
+
+    // 对src中的元素和它们的key按key稳定排序，结果移动到items和keys中
+    static void sort_by_keys(plist &src, plist &src_keys, plist &items, plist &keys) {
+        const std::vector<pcell> &k = src_keys;
+        std::vector<size_t> order(src.size());
+        for (size_t i = 0, n = order.size(); i < n; ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return k[a] < k[b];
+        });
+        items.reserve(order.size());
+        keys.reserve(order.size());
+        for (size_t i: order) {
+            items.push_back(std::move(*(src.begin() + i)));
+            keys.push_back(std::move(*(src_keys.begin() + i)));
+        }
+    }
+
+    // 把有序的src合并到有序的dst中：pos[j]为src[j]之前的dst中原有元素的个数。
+    // 先在末尾留出空间，再从后往前移动，每个元素只移动一次，不需要额外的缓冲区
+    static void spread(plist &dst, plist &src, const std::vector<size_t> &pos) {
+        size_t n = dst.size(), k = src.size();
+        dst.resize(n + k);
+        auto &d = static_cast<std::vector<pcell> &>(dst);
+        auto &s = static_cast<std::vector<pcell> &>(src);
+        size_t r = n; // dst中原有的元素[0, r)还未移动
+        for (size_t j = k; j-- > 0;) {
+            for (; r > pos[j]; --r) // 这些元素之前有j + 1个新元素
+                d[r + j] = std::move(d[r - 1]);
+            d[pos[j] + j] = std::move(s[j]);
+        }
+    }
+
+    // 合并已经排好序的新元素。先只做比较，确定每个新元素的位置，比较时抛出异常不会破坏列表；
+    // key相等时新元素放在原有元素之后
+    void merge_sorted(plist &items, plist &keys) {
+        const std::vector<pcell> &old = key_list(), &add = key_ ? keys : items;
+        size_t n = old.size(), k = add.size();
+        std::vector<size_t> pos(k);
+        for (size_t i = 0, j = 0; j < k; ++j) {
+            while (i < n && !(add[j] < old[i]))
+                ++i;
+            pos[j] = i;
+        }
+        spread(items_, items, pos);
+        if (key_)
+            spread(keys_, keys, pos);
+    }
+
+    // key等于k的元素所在的范围中与x相等的第一个元素，没有时返回-1
+    std::ptrdiff_t find(const pcell &x) const {
+        pcell k = key_of(x);
+        auto first = items_.begin() + bisect_left(k), last = items_.begin() + bisect_right(k);
+        auto it = std::find(first, last, x);
+        return it == last ? -1 : it - items_.begin();
+    }
+
+public:
+    sorted_plist() = default;
+    template<typename F, typename = typename std::enable_if<!std::is_convertible<F, plist>::value>::type>
+    explicit sorted_plist(F key) : key_(wrap(key)) {}
+    // 由任意顺序的plist构造，排序一次
+    explicit sorted_plist(plist pl) {
+        insert_many(std::move(pl));
+    }
+    template<typename F>
+    sorted_plist(plist pl, F key) : key_(wrap(key)) {
+        insert_many(std::move(pl));
+    }
+
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    plist::const_iterator begin() const { return items_.begin(); }
+    plist::const_iterator end() const { return items_.end(); }
+    // 按顺序排列的元素
+    const plist &items() const { return items_; }
+    // 和plist一样支持负数索引和切片，只读
+    const pcell &operator[](std::ptrdiff_t i) const { return items_[i]; }
+    const_plist_view operator[](pslice sl) const { return items_[sl]; }
+
+    // 和python的bisect_left、bisect_right一样，k是key而不是元素：
+    // 返回第一个不小于（大于）k的位置
+    size_t bisect_left(const pcell &k) const {
+        const plist &kl = key_list();
+        return std::lower_bound(kl.begin(), kl.end(), k) - kl.begin();
+    }
+    size_t bisect_right(const pcell &k) const {
+        const plist &kl = key_list();
+        return std::upper_bound(kl.begin(), kl.end(), k) - kl.begin();
+    }
+
+    // 放入一个元素，放在key相等的元素之后，返回其位置
+    size_t insort(pcell x) {
+        pcell k = key_of(x);
+        size_t i = bisect_right(k);
+        items_.insert(items_.begin() + i, std::move(x));
+        if (key_)
+            keys_.insert(keys_.begin() + i, std::move(k));
+        return i;
+    }
+    // 批量放入元素：对新元素排序，再合并到列表中。没有key函数时直接用plist::sort，可以走类型特化的快速路径
+    void insert_many(plist pl) {
+        if (!key_) {
+            plist none;
+            merge_sorted(pl.sort(), none);
+            return;
+        }
+        plist keys;
+        keys.reserve(pl.size());
+        for (const auto &x: pl)
+            keys.push_back(key_(x));
+        plist items, sorted_keys;
+        sort_by_keys(pl, keys, items, sorted_keys);
+        merge_sorted(items, sorted_keys);
+    }
+
+    // 二分查找，元素之间用==判断是否相同
+    bool contains(const pcell &x) const {
+        return find(x) != -1;
+    }
+    std::ptrdiff_t index(const pcell &x) const {
+        return find(x);
+    }
+    size_t count(const pcell &x) const {
+        pcell k = key_of(x);
+        auto first = items_.begin() + bisect_left(k), last = items_.begin() + bisect_right(k);
+        return std::count(first, last, x);
+    }
+
+    // 删除操作不会破坏顺序
+    void remove(const pcell &x) {
+        std::ptrdiff_t i = find(x);
+        if (i != -1)
+            erase(i);
+    }
+    void erase(std::ptrdiff_t i) {
+        size_t k = detail::__index_trans(i, size());
+        items_.erase(items_.begin() + k);
+        if (key_)
+            keys_.erase(keys_.begin() + k);
+    }
+    void erase(pslice sl) {
+        items_.erase(sl);
+        if (key_)
+            keys_.erase(sl);
+    }
+    void clear() {
+        items_.clear(), keys_.clear();
+    }
+
+    // 合并两个有序列表，结果使用a的key函数。两者都有key函数时应当是相同的函数，
+    // b中保存的key直接拷贝过来，不再重新计算；只有一方有key函数时b的顺序不能直接使用，需要重新排序
+    friend sorted_plist merge(const sorted_plist &a, const sorted_plist &b) {
+        sorted_plist res = a;
+        if (static_cast<bool>(a.key_) != static_cast<bool>(b.key_)) {
+            res.insert_many(b.items_);
+            return res;
+        }
+        plist items = b.items_, keys = b.keys_;
+        res.merge_sorted(items, keys);
+        return res;
+    }
+
+    plist to_plist() const {
+        return items_;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const sorted_plist &sl) {
+        return os << sl.items_;
+    }
+};
+
+}
+
+#endif //__CRZ_SORTED_PLIST_HH__